@@ -812,6 +812,17 @@ Item {
     */
     property alias hrSeek: mpvObject.hrSeek
 
+    /*!
+        \qmlproperty string MpvPlayer::videoSync
+
+        How audio and video are synchronized, e.g. \c audio to time video by
+        the audio clock as libmpv does by default. It is
+        \c display-resample here, which times frames by the display and
+        resamples audio to match. Set it before the player is initialized to
+        avoid switching modes during playback.
+    */
+    property alias videoSync: mpvObject.videoSync
+
     /*!
         \qmlproperty bool MpvPlayer::ytdl
 
@@ -1006,6 +1017,201 @@ Item {
     */
     property alias estimatedVfFps: mpvObject.estimatedVfFps
 
+    /*!
+        \qmlproperty int MpvPlayer::eventBatchSize
+
+        Maximum number of libmpv events handled in one go on the GUI thread.
+        Any remaining events are handled in the next event loop iteration, so
+        a burst of events can't stall animations. \c 0 means no limit.
+
+        The default value is \c 64.
+    */
+    property alias eventBatchSize: mpvObject.eventBatchSize
+
+    /*!
+        \qmlproperty int MpvPlayer::eventBatchTimeBudget
+
+        Maximum time, in \b microseconds, spent handling libmpv events in one
+        go on the GUI thread. \c 0 means no limit.
+
+        The default value is \c 2000.
+    */
+    property alias eventBatchTimeBudget: mpvObject.eventBatchTimeBudget
+
+    /*!
+        \qmlproperty var MpvPlayer::notificationRates
+
+        Maximum rate, in Hz, at which the change signals of frequently updated
+        properties are emitted, keyed by libmpv property name. Changes in
+        between are coalesced, bindings always see the latest value. A
+        negative rate means the refresh rate of the screen. Properties that
+        are not in the map are notified on every change.
+
+        The default value is:
+        \code
+        {
+            "time-pos": -1, "percent-pos": -1, "avsync": 10,
+            "estimated-vf-fps": 10, "video-bitrate": 10, "audio-bitrate": 10
+        }
+        \endcode
+    */
+    property alias notificationRates: mpvObject.notificationRates
+
+    /*!
+        \qmlproperty bool MpvPlayer::scrubbing
+
+        Whether a timeline scrub is in progress.
+
+        \sa beginScrub(), scrubTo(), endScrub()
+    */
+    property alias scrubbing: mpvObject.scrubbing
+
+    /*!
+        \qmlproperty int MpvPlayer::seekLatency
+
+        Time it took the last seek to complete, from sending it to the
+        playback resuming at the new position. Useful to tune scrubbing on
+        content with long keyframe intervals.
+
+        The unit of it is \b MILLISECONDS.
+    */
+    property alias seekLatency: mpvObject.seekLatency
+
+    /*!
+        \qmlproperty bool MpvPlayer::asynchronousInitialization
+
+        Run mpv's initialization on a worker thread, so that creating the
+        player doesn't block the GUI thread. The properties given in QML are
+        applied as options beforehand either way. Only takes effect if set
+        at construction.
+
+        Default is \c false.
+    */
+    property alias asynchronousInitialization: mpvObject.asynchronousInitialization
+
+    /*!
+        \qmlproperty int MpvPlayer::handlePoolSize
+
+        Number of initialized mpv instances kept around, so that new players
+        can start without waiting for mpv to initialize. The pool is filled
+        in the background, and instances of destroyed players go back to it
+        after playback was stopped and their options were reset.
+
+        Players setting options that only apply when libmpv starts, like
+        \l loadScripts, \l ytdl, \l profile, \l vo or \l ao, don't take an
+        instance from the pool and initialize their own.
+
+        This setting is shared by all players of the application.
+
+        Default is \c 0 (disabled).
+    */
+    property alias handlePoolSize: mpvObject.handlePoolSize
+
+    /*!
+        \qmlproperty bool MpvPlayer::directRendering
+
+        Render the video straight into the window instead of an intermediate
+        texture, saving a full-size copy per frame. The video is drawn before
+        the rest of the scene, so controls and other items stacked above the
+        player are still shown. This is only possible while the player and its
+        parents are visible, opaque and not in a layer or effect, the player
+        is untransformed, not clipped, covers the whole window and nothing
+        visible is drawn below it, like a window background.
+        Otherwise the texture is used, so it's always safe to enable.
+
+        Default is \c false.
+    */
+    property alias directRendering: mpvObject.directRendering
+
+    /*!
+        \qmlproperty size MpvPlayer::framebufferSize
+
+        Size of the texture the video is rendered into, in pixels. While the
+        player is being resized, e.g. by an animation, the video keeps being
+        rendered at the previous size and is scaled. The texture is only
+        reallocated once the size has settled and doesn't fit anymore.
+    */
+    property alias framebufferSize: mpvObject.framebufferSize
+
+    /*!
+        \qmlproperty Item MpvPlayer::videoItem
+
+        The item rendering the video. It's a texture provider, so it can be
+        used as the source of e.g. a \c ShaderEffect or another item's
+        texture to show the same stream in several places while decoding it
+        only once. Direct rendering is disabled while it's used that way.
+    */
+    property alias videoItem: mpvObject
+
+    /*!
+        \qmlproperty enumeration MpvPlayer::renderBackend
+
+        How the video is rendered, should be one of
+        \c MpvDeclarativeObject::Automatic, \c MpvDeclarativeObject::OpenGL
+        and \c MpvDeclarativeObject::Software.
+
+        The software backend renders on the CPU with mpv's software renderer,
+        which is faster than its OpenGL renderer on machines without a GPU
+        (e.g. llvmpipe), and also works with Qt Quick's software backend. It
+        needs libmpv 0.36 or newer. \c Automatic picks it when there's no
+        hardware accelerated OpenGL. Only takes effect if set before the
+        first frame.
+
+        The default is \c MpvDeclarativeObject::Automatic.
+    */
+    property alias renderBackend: mpvObject.renderBackend
+
+    /*!
+        \qmlproperty bool MpvPlayer::frameReadback
+
+        Read the rendered frames back to the CPU for recording or streaming,
+        without stalling the GPU. The frames are handed to the frame sink set
+        from C++ with \c MpvDeclarativeObject::setFrameSink(), a few frames
+        after they were rendered. Direct and software rendering aren't read
+        back.
+
+        Default is \c false.
+
+        \sa readbackFrameCount, droppedReadbackFrameCount
+    */
+    property alias frameReadback: mpvObject.frameReadback
+
+    /*!
+        \qmlproperty int MpvPlayer::readbackFrameCount
+
+        Number of frames handed to the frame sink so far.
+    */
+    property alias readbackFrameCount: mpvObject.readbackFrameCount
+
+    /*!
+        \qmlproperty int MpvPlayer::droppedReadbackFrameCount
+
+        Number of frames that weren't read back because the GPU or the frame
+        sink couldn't keep up.
+    */
+    property alias droppedReadbackFrameCount: mpvObject.droppedReadbackFrameCount
+
+    /*!
+        \qmlproperty int MpvPlayer::screenshotConcurrency
+
+        Number of screenshots \l screenshotToFileAsync() encodes at the same
+        time.
+
+        The default is \c 2.
+    */
+    property alias screenshotConcurrency: mpvObject.screenshotConcurrency
+
+    /*!
+        \qmlproperty int MpvPlayer::screenshotQueueDepth
+
+        Maximum number of screenshots waiting to be grabbed or encoded by
+        \l screenshotToFileAsync(). Further screenshots are dropped until
+        some of them are done, so that bursts never stall the playback.
+
+        The default is \c 8.
+    */
+    property alias screenshotQueueDepth: mpvObject.screenshotQueueDepth
+
     /*!
         \qmlsignal MpvPlayer::initFinished()
 
@@ -1015,6 +1221,18 @@ Item {
     */
     signal initFinished
 
+    /*!
+        \qmlsignal MpvPlayer::initFailed(error)
+
+        This signal is emitted when libmpv failed to initialize, or to create
+        its renderer, \a error being the negative libmpv error code. The player can't be used
+        afterwards: commands and property changes are refused, and nothing is
+        rendered.
+
+        The corresponding handler is \c onInitFailed.
+    */
+    signal initFailed(int error)
+
     /*!
         \qmlsignal MpvPlayer::loaded()
 
@@ -1052,12 +1270,59 @@ Item {
     signal stopped
 
     /*!
-        \qmlmethod MpvPlayer::open(url)
+        \qmlsignal MpvPlayer::commandFinished(id, error, result)
+
+        This signal is emitted when libmpv has handled the asynchronous request
+        \a id, as returned by \l commandAsync() or \l setPropertyAsync(), and
+        for every request sent while \l mpvCallType is asynchronous. \a error
+        is \c 0 on success and a negative libmpv error code otherwise.
+        \a result is the result of the command, if any.
+
+        The corresponding handler is \c onCommandFinished.
+    */
+    signal commandFinished(var id, int error, var result)
+
+    /*!
+        \qmlsignal MpvPlayer::frameGrabbed(id, error, image)
+
+        This signal is emitted when the frame requested by \l grabFrame()
+        with the id \a id is ready. \a error is \c 0 on success and a
+        negative libmpv error code otherwise.
+
+        The corresponding handler is \c onFrameGrabbed.
+    */
+    signal frameGrabbed(var id, int error, var image)
+
+    /*!
+        \qmlsignal MpvPlayer::screenshotSaved(id, error, filePath, grabTime, encodeTime)
+
+        This signal is emitted when the screenshot requested by
+        \l screenshotToFileAsync() with the id \a id was written to
+        \a filePath. \a error is \c 0 on success and a negative libmpv error
+        code otherwise. \a grabTime and \a encodeTime are the time it took
+        to get the frame from libmpv and to encode it.
+
+        The unit of them is \b MILLISECONDS.
+
+        The corresponding handler is \c onScreenshotSaved.
+    */
+    signal screenshotSaved(var id, int error, string filePath, int grabTime,
+                           int encodeTime)
+
+    /*!
+        \qmlmethod MpvPlayer::open(url, fileOptions)
 
         Load the given \a url and start the playback immediately.
+
+        The optional \a fileOptions map holds libmpv options which only apply
+        while this file is played, e.g. \c {{"start": "30"}}.
     */
-    function open(url) {
-        mpvObject.open(url);
+    function open(url, fileOptions) {
+        if (fileOptions === undefined) {
+            mpvObject.open(url);
+        } else {
+            mpvObject.open(url, fileOptions);
+        }
     }
 
     /*!
@@ -1138,6 +1403,39 @@ Item {
         mpvObject.seekPercent(percent);
     }
 
+    /*!
+        \qmlmethod MpvPlayer::beginScrub()
+
+        Start scrubbing the timeline, e.g. when a seek slider is pressed.
+
+        \sa scrubTo(), endScrub()
+    */
+    function beginScrub() {
+        return mpvObject.beginScrub();
+    }
+
+    /*!
+        \qmlmethod MpvPlayer::scrubTo(position)
+
+        Seek to the keyframe nearest to \a position while scrubbing. While a
+        seek is in progress, only the latest position is kept.
+
+        The unit of it is \b SECONDS.
+    */
+    function scrubTo(position) {
+        return mpvObject.scrubTo(position);
+    }
+
+    /*!
+        \qmlmethod MpvPlayer::endScrub()
+
+        Stop scrubbing, and seek exactly to the last position given to
+        \l scrubTo().
+    */
+    function endScrub() {
+        return mpvObject.endScrub();
+    }
+
     /*!
         \qmlmethod MpvPlayer::screenshot()
 
@@ -1159,6 +1457,19 @@ Item {
         mpvObject.screenshotToFile(path);
     }
 
+    /*!
+        \qmlmethod MpvPlayer::screenshotToFileAsync(path, mode)
+
+        Take a screenshot and save it to the given \a path on a worker
+        thread, without blocking libmpv or the GUI. \a mode is the same as
+        for \l grabFrame(). Returns the request id that \l screenshotSaved()
+        will be emitted with, or a negative libmpv error code.
+    */
+    function screenshotToFileAsync(path, mode) {
+        return mpvObject.screenshotToFileAsync(path, mode === undefined
+                                               ? MpvObject.Subtitles : mode);
+    }
+
     /*!
         \qmlmethod MpvPlayer::isPlaying()
 
@@ -1186,13 +1497,115 @@ Item {
         return mpvObject.playbackState === MpvObject.Stopped;
     }
 
+    /*!
+        \qmlmethod MpvPlayer::playbackSnapshot()
+
+        Returns the current \c playbackState, \c mediaStatus, \c duration,
+        \c position, \c percentPos, \c avsync, \c seekable and \c videoSize
+        in a single map. Prefer this over reading the individual properties
+        when several of them are needed at once, e.g. for a progress bar.
+    */
+    function playbackSnapshot() {
+        return mpvObject.playbackSnapshot();
+    }
+
+    /*!
+        \qmlmethod MpvPlayer::getPropertyAsync(name, callback)
+
+        Query the libmpv property \a name without blocking the GUI thread,
+        which is useful for expensive properties such as \c track-list,
+        \c chapter-list or \c demuxer-cache-state.
+
+        \a callback is called later with the value and an error code, which is
+        \c 0 on success and a negative libmpv error code otherwise. If no
+        \a callback is given, a \c Promise is returned instead, which is
+        rejected with the error code on failure.
+    */
+    function getPropertyAsync(name, callback) {
+        if (callback !== undefined) {
+            return mpvObject.getPropertyAsync(name, callback);
+        }
+        return new Promise(function(resolve, reject) {
+            const sent = mpvObject.getPropertyAsync(name, function(value, error) {
+                if (error < 0) {
+                    reject(error);
+                } else {
+                    resolve(value);
+                }
+            });
+            if (!sent) {
+                // MPV_ERROR_INVALID_PARAMETER
+                reject(-4);
+            }
+        });
+    }
+
+    /*!
+        \qmlmethod MpvPlayer::commandAsync(arguments, callback)
+
+        Run the libmpv command \a arguments, e.g. \c {["loadfile", url]},
+        without blocking the GUI thread. Returns the request id that
+        \l commandFinished() will be emitted with, or a negative libmpv error
+        code if the command couldn't be sent. The optional \a callback is
+        called with the result and the error code. Before libmpv is
+        initialized, the command is run once it is and \c 0 is returned;
+        neither the callback nor \l commandFinished() are called for it.
+    */
+    function commandAsync(arguments, callback) {
+        return mpvObject.commandAsync(arguments, callback);
+    }
+
+    /*!
+        \qmlmethod MpvPlayer::setPropertyAsync(name, value, callback)
+
+        Set the libmpv property \a name to \a value without blocking the GUI
+        thread. Returns the request id, as \l commandAsync() does.
+    */
+    function setPropertyAsync(name, value, callback) {
+        return mpvObject.setPropertyAsync(name, value, callback);
+    }
+
+    /*!
+        \qmlmethod MpvPlayer::setProperties(properties)
+
+        Set all the libmpv properties in the \a properties map at once,
+        without blocking the GUI thread. Their change signals are held back
+        until libmpv has acknowledged all of them, so bindings are only
+        re-evaluated once, e.g. when applying a set of user preferences. Other
+        properties keep notifying in the meantime.
+    */
+    function setProperties(properties) {
+        return mpvObject.setProperties(properties);
+    }
+
+    /*!
+        \qmlmethod MpvPlayer::grabFrame(mode, callback)
+
+        Grab the current frame as an image in memory, without encoding it to
+        a file. \a mode should be one of \c MpvDeclarativeObject::Video (the
+        video only), \c MpvDeclarativeObject::Subtitles (with subtitles, the
+        default) and \c MpvDeclarativeObject::Window (as displayed, scaled to
+        the player). Returns the request id that \l frameGrabbed() will be
+        emitted with, or a negative libmpv error code. The optional
+        \a callback is called with the image and the error code.
+    */
+    function grabFrame(mode, callback) {
+        return mpvObject.grabFrame(mode === undefined ? MpvObject.Subtitles
+                                                      : mode, callback);
+    }
+
     MpvObject {
         id: mpvObject
         anchors.fill: mpvPlayer
         onInitFinished: mpvPlayer.initFinished()
+        onInitFailed: mpvPlayer.initFailed(error)
         onLoaded: mpvPlayer.loaded()
         onPlaying: mpvPlayer.playing()
         onPaused: mpvPlayer.paused()
         onStopped: mpvPlayer.stopped()
+        onCommandFinished: mpvPlayer.commandFinished(id, error, result)
+        onFrameGrabbed: mpvPlayer.frameGrabbed(id, error, image)
+        onScreenshotSaved: mpvPlayer.screenshotSaved(id, error, filePath,
+                                                     grabTime, encodeTime)
     }
 }
@@ -0,0 +1,10 @@
+TEMPLATE = app
+TARGET = mpvbench
+QT += quick
+
+# Loads the installed plugin, build and install it first.
+SOURCES += main.cpp
+
+RESOURCES += bench.qrc
+
+DISTFILES += main.qml
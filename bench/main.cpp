@@ -0,0 +1,128 @@
+// Plays lavfi's testsrc with each render backend in turn and prints how long
+// the render thread spent on every frame, and the time between swaps.
+
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QGuiApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQmlError>
+#include <QQuickItem>
+#include <QQuickView>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <clocale>
+#include <cstdio>
+
+namespace {
+
+// Skips the initialization and the first frames.
+constexpr int warmupMs = 3000;
+constexpr int measureMs = 10000;
+
+struct FrameTimes {
+    QMutex mutex;
+    bool recording = false;
+    // beforeRendering to afterRendering, in nanoseconds.
+    QVector<qint64> render;
+    // Between two frameSwapped, in nanoseconds.
+    QVector<qint64> interval;
+};
+
+void printStats(const char *name, QVector<qint64> samples) {
+    if (samples.isEmpty()) {
+        std::printf("  %-8s no frames\n", name);
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    qint64 total = 0;
+    for (const qint64 sample : qAsConst(samples)) {
+        total += sample;
+    }
+    const auto ms = [](qint64 ns) { return double(ns) / 1000000.0; };
+    std::printf("  %-8s %5d frames, mean %6.2f ms, median %6.2f ms, "
+                "99th %6.2f ms, max %6.2f ms\n",
+                name, samples.size(), ms(total / samples.size()),
+                ms(samples.at(samples.size() / 2)),
+                ms(samples.at(samples.size() * 99 / 100)),
+                ms(samples.last()));
+}
+
+bool run(const char *backend) {
+    FrameTimes times;
+    QElapsedTimer clock;
+    // Only touched on the render thread.
+    qint64 renderStart = 0;
+    qint64 lastSwap = -1;
+
+    QQuickView view;
+    view.setResizeMode(QQuickView::SizeRootObjectToView);
+    view.setSource(QUrl(QStringLiteral("qrc:/main.qml")));
+    QQuickItem *player = view.rootObject();
+    if (player == nullptr) {
+        for (const QQmlError &error : view.errors()) {
+            std::fprintf(stderr, "%s\n", qPrintable(error.toString()));
+        }
+        return false;
+    }
+    // The backend is picked on the first frame.
+    player->setProperty("renderBackend", QString::fromLatin1(backend));
+
+    QObject::connect(
+        &view, &QQuickWindow::beforeRendering, &view,
+        [&]() { renderStart = clock.nsecsElapsed(); }, Qt::DirectConnection);
+    QObject::connect(
+        &view, &QQuickWindow::afterRendering, &view,
+        [&]() {
+            const qint64 elapsed = clock.nsecsElapsed() - renderStart;
+            QMutexLocker locker(&times.mutex);
+            if (times.recording) {
+                times.render.append(elapsed);
+            }
+        },
+        Qt::DirectConnection);
+    QObject::connect(
+        &view, &QQuickWindow::frameSwapped, &view,
+        [&]() {
+            const qint64 now = clock.nsecsElapsed();
+            QMutexLocker locker(&times.mutex);
+            if (times.recording && (lastSwap >= 0)) {
+                times.interval.append(now - lastSwap);
+            }
+            lastSwap = now;
+        },
+        Qt::DirectConnection);
+
+    QEventLoop loop;
+    QTimer::singleShot(warmupMs, &loop, [&times]() {
+        QMutexLocker locker(&times.mutex);
+        times.recording = true;
+    });
+    QTimer::singleShot(warmupMs + measureMs, &loop, &QEventLoop::quit);
+    clock.start();
+    view.show();
+    loop.exec();
+    view.hide();
+
+    QMutexLocker locker(&times.mutex);
+    times.recording = false;
+    std::printf("%s\n", backend);
+    printStats("render", times.render);
+    printStats("interval", times.interval);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QGuiApplication application(argc, argv);
+    // mpv refuses to start with any other numeric locale.
+    std::setlocale(LC_NUMERIC, "C");
+    for (const char *backend : {"OpenGL", "Software"}) {
+        if (!run(backend)) {
+            return 1;
+        }
+    }
+    return 0;
+}
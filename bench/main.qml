@@ -0,0 +1,11 @@
+import QtQuick 2.12
+import wangwenx190.QuickMpv 1.0
+
+// renderBackend is set by main.cpp before the window is shown.
+MpvObject {
+    width: 1280
+    height: 720
+    mute: true
+    // An endless 1080p60 test pattern, no file needed.
+    onInitFinished: source = "av://lavfi:testsrc=size=1920x1080:rate=60"
+}
@@ -1,24 +1,274 @@
 #include "mpvdeclarativeobject.h"
 #include <QDebug>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <QJSEngine>
+#include <QMetaMethod>
 #include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QPointer>
 #include <QQuickWindow>
+#include <QSGRendererInterface>
+#include <QSGTextureProvider>
+#include <QSGSimpleTextureNode>
+#include <QScreen>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <functional>
 #if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
 #include <QX11Info>
 #include <QGuiApplication>
 #endif
 
+// Properties cached by every player. The index in mpvProperties is used as
+// reply_userdata (offset by one, 0 is never used), so that property change
+// events can be dispatched without any string comparison.
+enum class MpvProperty : int {
+    DWidth,
+    DHeight,
+    VideoOutParams,
+    Duration,
+    TimePos,
+    Volume,
+    Mute,
+    Seekable,
+    HwdecCurrent,
+    Vid,
+    Aid,
+    Sid,
+    VideoRotate,
+    VideoAspect,
+    Speed,
+    Deinterlace,
+    AudioExclusive,
+    AudioFileAuto,
+    SubAuto,
+    SubCodepage,
+    FileName,
+    MediaTitle,
+    Vo,
+    Ao,
+    ScreenshotFormat,
+    ScreenshotPngCompression,
+    ScreenshotTemplate,
+    ScreenshotDirectory,
+    Profile,
+    HrSeek,
+    VideoSync,
+    Ytdl,
+    LoadScripts,
+    Path,
+    FileFormat,
+    FileSize,
+    VideoBitrate,
+    AudioBitrate,
+    AudioDeviceList,
+    ScreenshotTagColorspace,
+    ScreenshotJpegQuality,
+    VideoFormat,
+    MsgLevel,
+    Pause,
+    IdleActive,
+    TrackList,
+    ChapterList,
+    Metadata,
+    Avsync,
+    PercentPos,
+    EstimatedVfFps,
+    MpvVersion,
+    MpvConfiguration,
+    FfmpegVersion,
+    Count
+};
+
 namespace {
 
+struct MpvPropertyInfo {
+    const char *name;
+    // The format mpv should deliver the value in. MPV_FORMAT_NONE means the
+    // property is only used as a change trigger.
+    mpv_format format;
+    void (MpvDeclarativeObject::*notifySignal)();
+    // Changes all the time during playback, don't log it.
+    bool quiet;
+};
+
+// Must be kept in the same order as MpvProperty.
+constexpr MpvPropertyInfo mpvProperties[] = {
+    {"dwidth", MPV_FORMAT_INT64,
+     &MpvDeclarativeObject::videoSizeChanged, false},
+    {"dheight", MPV_FORMAT_INT64,
+     &MpvDeclarativeObject::videoSizeChanged, false},
+    {"video-out-params", MPV_FORMAT_NODE, nullptr, false},
+    {"duration", MPV_FORMAT_DOUBLE,
+     &MpvDeclarativeObject::durationChanged, false},
+    {"time-pos", MPV_FORMAT_DOUBLE,
+     &MpvDeclarativeObject::positionChanged, true},
+    {"volume", MPV_FORMAT_DOUBLE, &MpvDeclarativeObject::volumeChanged, false},
+    {"mute", MPV_FORMAT_FLAG, &MpvDeclarativeObject::muteChanged, false},
+    {"seekable", MPV_FORMAT_FLAG,
+     &MpvDeclarativeObject::seekableChanged, false},
+    {"hwdec-current", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::hwdecChanged, false},
+    {"vid", MPV_FORMAT_NODE, &MpvDeclarativeObject::vidChanged, false},
+    {"aid", MPV_FORMAT_NODE, &MpvDeclarativeObject::aidChanged, false},
+    {"sid", MPV_FORMAT_NODE, &MpvDeclarativeObject::sidChanged, false},
+    {"video-rotate", MPV_FORMAT_NONE,
+     &MpvDeclarativeObject::videoRotateChanged, false},
+    {"video-aspect", MPV_FORMAT_NONE,
+     &MpvDeclarativeObject::videoAspectChanged, false},
+    {"speed", MPV_FORMAT_DOUBLE, &MpvDeclarativeObject::speedChanged, false},
+    {"deinterlace", MPV_FORMAT_FLAG,
+     &MpvDeclarativeObject::deinterlaceChanged, false},
+    {"audio-exclusive", MPV_FORMAT_FLAG,
+     &MpvDeclarativeObject::audioExclusiveChanged, false},
+    {"audio-file-auto", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::audioFileAutoChanged, false},
+    {"sub-auto", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::subAutoChanged, false},
+    {"sub-codepage", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::subCodepageChanged, false},
+    {"filename", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::fileNameChanged, false},
+    {"media-title", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::mediaTitleChanged, false},
+    {"vo", MPV_FORMAT_STRING, &MpvDeclarativeObject::voChanged, false},
+    {"ao", MPV_FORMAT_STRING, &MpvDeclarativeObject::aoChanged, false},
+    {"screenshot-format", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::screenshotFormatChanged, false},
+    {"screenshot-png-compression", MPV_FORMAT_INT64,
+     &MpvDeclarativeObject::screenshotPngCompressionChanged, false},
+    {"screenshot-template", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::screenshotTemplateChanged, false},
+    {"screenshot-directory", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::screenshotDirectoryChanged, false},
+    {"profile", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::profileChanged, false},
+    {"hr-seek", MPV_FORMAT_STRING, &MpvDeclarativeObject::hrSeekChanged, false},
+    {"video-sync", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::videoSyncChanged, false},
+    {"ytdl", MPV_FORMAT_FLAG, &MpvDeclarativeObject::ytdlChanged, false},
+    {"load-scripts", MPV_FORMAT_FLAG,
+     &MpvDeclarativeObject::loadScriptsChanged, false},
+    {"path", MPV_FORMAT_STRING, &MpvDeclarativeObject::pathChanged, false},
+    {"file-format", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::fileFormatChanged, false},
+    {"file-size", MPV_FORMAT_INT64,
+     &MpvDeclarativeObject::fileSizeChanged, false},
+    {"video-bitrate", MPV_FORMAT_DOUBLE,
+     &MpvDeclarativeObject::videoBitrateChanged, true},
+    {"audio-bitrate", MPV_FORMAT_DOUBLE,
+     &MpvDeclarativeObject::audioBitrateChanged, true},
+    {"audio-device-list", MPV_FORMAT_NODE,
+     &MpvDeclarativeObject::audioDeviceListChanged, false},
+    {"screenshot-tag-colorspace", MPV_FORMAT_FLAG,
+     &MpvDeclarativeObject::screenshotTagColorspaceChanged, false},
+    {"screenshot-jpeg-quality", MPV_FORMAT_INT64,
+     &MpvDeclarativeObject::screenshotJpegQualityChanged, false},
+    {"video-format", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::videoFormatChanged, false},
+    {"msg-level", MPV_FORMAT_STRING,
+     &MpvDeclarativeObject::logLevelChanged, false},
+    {"pause", MPV_FORMAT_FLAG,
+     &MpvDeclarativeObject::playbackStateChanged, false},
+    {"idle-active", MPV_FORMAT_FLAG,
+     &MpvDeclarativeObject::playbackStateChanged, false},
+    {"track-list", MPV_FORMAT_NODE,
+     &MpvDeclarativeObject::mediaTracksChanged, false},
+    {"chapter-list", MPV_FORMAT_NODE,
+     &MpvDeclarativeObject::chaptersChanged, false},
+    {"metadata", MPV_FORMAT_NODE,
+     &MpvDeclarativeObject::metadataChanged, false},
+    {"avsync", MPV_FORMAT_DOUBLE, &MpvDeclarativeObject::avsyncChanged, true},
+    {"percent-pos", MPV_FORMAT_DOUBLE,
+     &MpvDeclarativeObject::percentPosChanged, true},
+    {"estimated-vf-fps", MPV_FORMAT_DOUBLE,
+     &MpvDeclarativeObject::estimatedVfFpsChanged, true},
+    {"mpv-version", MPV_FORMAT_STRING, nullptr, false},
+    {"mpv-configuration", MPV_FORMAT_STRING, nullptr, false},
+    {"ffmpeg-version", MPV_FORMAT_STRING, nullptr, false},
+};
+
+static_assert(sizeof(mpvProperties) / sizeof(mpvProperties[0]) ==
+                  static_cast<size_t>(MpvProperty::Count),
+              "mpvProperties and MpvProperty are out of sync");
+
+constexpr int mpvPropertyCount = static_cast<int>(MpvProperty::Count);
+
+// reply_userdata of asynchronous requests starts here, the ids below are
+// used for property observation (see MpvProperty).
+constexpr quint64 asyncRequestIdBase = quint64(1) << 32;
+
+// Upper bound of asynchronous commands and property sets waiting for their
+// reply. mpv's own event queue is not much larger, going beyond it would only
+// lose replies.
+constexpr int maxPendingAsyncRequests = 256;
+
+// Inputs of the playback snapshot and of the playback state events. They are
+// needed internally, so they are observed all the time. Everything else is
+// only observed while its notify signal is connected, including time-pos,
+// percent-pos and avsync which change on every frame; they are read on demand
+// otherwise.
+constexpr MpvProperty alwaysObservedProperties[] = {
+    MpvProperty::DWidth,   MpvProperty::DHeight,  MpvProperty::VideoOutParams,
+    MpvProperty::Duration, MpvProperty::Seekable, MpvProperty::Pause,
+    MpvProperty::IdleActive,
+};
+
+struct MpvNotificationRate {
+    MpvProperty property;
+    // In Hz, negative means the refresh rate of the screen.
+    qreal rate;
+};
+
+// Properties that change on every frame during playback. Nothing in a UI
+// needs them more often than it can draw, and statistics are unreadable
+// above a few updates per second anyway.
+constexpr MpvNotificationRate defaultNotificationRates[] = {
+    {MpvProperty::TimePos, -1.0},      {MpvProperty::PercentPos, -1.0},
+    {MpvProperty::Avsync, 10.0},       {MpvProperty::EstimatedVfFps, 10.0},
+    {MpvProperty::VideoBitrate, 10.0}, {MpvProperty::AudioBitrate, 10.0},
+};
+
+// First argument of a command, or the "name" of a command with named
+// arguments, for diagnostics.
+QString commandName(const QStringList &arguments) { return arguments.value(0); }
+
+QString commandName(const QVariant &arguments) {
+    if ((arguments.type() == QVariant::Map) ||
+        (arguments.type() == QVariant::Hash)) {
+        return arguments.toMap().value(QLatin1String("name")).toString();
+    }
+    const QVariantList list = arguments.toList();
+    return list.isEmpty() ? QString() : list.constFirst().toString();
+}
+
+// Only used on the (rare) property set path, never for event dispatch.
+int mpvPropertyIndex(const QString &name) {
+    for (int i = 0; i < mpvPropertyCount; ++i) {
+        if (name == QLatin1String(mpvProperties[i].name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 void wakeup(void *ctx) {
     // This callback is invoked from any mpv thread (but possibly also
     // recursively from a thread that is calling the mpv API). Just notify
     // the Qt GUI thread to wake up (so that it can process events with
     // mpv_wait_event()), and return as quickly as possible.
-    QMetaObject::invokeMethod(static_cast<MpvDeclarativeObject *>(ctx),
-                              "hasMpvEvents", Qt::QueuedConnection);
+    MpvDeclarativeObject::on_wakeup(ctx);
 }
 
+// With advanced control this must not call into mpv, render() asks whether
+// there is a new frame.
 void on_mpv_redraw(void *ctx) { MpvDeclarativeObject::on_update(ctx); }
 
 void *get_proc_address_mpv(void *ctx, const char *name) {
@@ -30,8 +280,200 @@ void *get_proc_address_mpv(void *ctx, const char *name) {
     return reinterpret_cast<void *>(glctx->getProcAddress(QByteArray(name)));
 }
 
+// Options that only take effect when mpv is initialized, or that reinitialize
+// the video or audio output when set at runtime. Players setting any of them
+// initialize a handle of their own instead of taking one from the pool.
+constexpr const char *initOnlyOptions[] = {
+    "config",     "config-dir", "include", "input-conf", "load-scripts",
+    "script",     "scripts",    "ytdl",    "profile",    "log-file",
+    "vo",         "ao",         "gpu-api", "gpu-context"};
+
+bool isInitOnlyOption(const QString &name) {
+    for (const char *option : initOnlyOptions) {
+        if (name == QLatin1String(option)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// FBOs are allocated in steps of this many pixels.
+constexpr int framebufferStep = 256;
+// How long the item size has to stay the same before the video is rendered
+// at that size, in milliseconds.
+constexpr int resizeSettleDelay = 150;
+
+const char *screenshotModeName(MpvDeclarativeObject::ScreenshotMode mode) {
+    switch (mode) {
+    case MpvDeclarativeObject::ScreenshotMode::Video:
+        return "video";
+    case MpvDeclarativeObject::ScreenshotMode::Subtitles:
+        return "subtitles";
+    case MpvDeclarativeObject::ScreenshotMode::Window:
+        return "window";
+    }
+    return "subtitles";
+}
+
+// Wraps the result of screenshot-raw without copying the pixels. The node is
+// freed along with the last copy of the image.
+QImage screenshotToImage(mpv_node *node) {
+    const auto freeNode = [](void *info) {
+        auto *result = static_cast<mpv_node *>(info);
+        mpv_free_node_contents(result);
+        delete result;
+    };
+    if (node->format != MPV_FORMAT_NODE_MAP) {
+        freeNode(node);
+        return {};
+    }
+    qint64 width = 0, height = 0, stride = 0;
+    const char *format = "";
+    const mpv_byte_array *data = nullptr;
+    const mpv_node_list *map = node->u.list;
+    for (int i = 0; i < map->num; ++i) {
+        const char *key = map->keys[i];
+        const mpv_node &value = map->values[i];
+        if ((value.format == MPV_FORMAT_INT64) && (qstrcmp(key, "w") == 0)) {
+            width = value.u.int64;
+        } else if ((value.format == MPV_FORMAT_INT64) &&
+                   (qstrcmp(key, "h") == 0)) {
+            height = value.u.int64;
+        } else if ((value.format == MPV_FORMAT_INT64) &&
+                   (qstrcmp(key, "stride") == 0)) {
+            stride = value.u.int64;
+        } else if ((value.format == MPV_FORMAT_STRING) &&
+                   (qstrcmp(key, "format") == 0)) {
+            format = value.u.string;
+        } else if ((value.format == MPV_FORMAT_BYTE_ARRAY) &&
+                   (qstrcmp(key, "data") == 0)) {
+            data = value.u.ba;
+        }
+    }
+    // Byte orders of mpv's formats, as QImage formats.
+    QImage::Format imageFormat = QImage::Format_Invalid;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if (qstrcmp(format, "bgr0") == 0) {
+        imageFormat = QImage::Format_RGB32;
+    } else if (qstrcmp(format, "bgra") == 0) {
+        imageFormat = QImage::Format_ARGB32;
+    }
+#endif
+    if (qstrcmp(format, "rgba") == 0) {
+        imageFormat = QImage::Format_RGBA8888;
+    }
+    if ((data == nullptr) || (imageFormat == QImage::Format_Invalid) ||
+        (width <= 0) || (height <= 0) ||
+        (qint64(data->size) < (stride * height))) {
+        freeNode(node);
+        return {};
+    }
+    return QImage(static_cast<uchar *>(data->data), int(width), int(height),
+                  int(stride), imageFormat, freeNode, node);
+}
+
+// Run screenshot-raw synchronously, call it from a worker thread.
+int grabScreenshot(mpv_handle *ctx, const QByteArray &flags, QImage *image) {
+    auto *result = new mpv_node;
+    const char *arguments[]{"screenshot-raw", flags.constData(), nullptr};
+    const int errorCode = mpv_command_ret(ctx, arguments, result);
+    if (errorCode < 0) {
+        delete result;
+        return errorCode;
+    }
+    *image = screenshotToImage(result);
+    return image->isNull() ? MPV_ERROR_UNSUPPORTED : errorCode;
+}
+
+// Number of PBOs frames are read back through, i.e. how many frames late
+// they may arrive at the sink.
+constexpr int readbackRingSize = 3;
+
+// Whether item or any of its children draws something.
+bool drawsContent(const QQuickItem *item) {
+    if (!item->isVisible() || qFuzzyIsNull(item->opacity())) {
+        return false;
+    }
+    if (item->flags().testFlag(QQuickItem::ItemHasContents)) {
+        return true;
+    }
+    const QList<QQuickItem *> children = item->childItems();
+    return std::any_of(children.cbegin(), children.cend(), drawsContent);
+}
+
+// Whether anything is drawn before item, i.e. below it. Parents are drawn
+// before their children, and siblings in order of z, then of creation.
+bool drawsBelow(const QQuickItem *item) {
+    const QList<QQuickItem *> ownChildren = item->childItems();
+    for (const QQuickItem *child : ownChildren) {
+        if ((child->z() < 0.0) && drawsContent(child)) {
+            return true;
+        }
+    }
+    for (const QQuickItem *current = item; current->parentItem() != nullptr;
+         current = current->parentItem()) {
+        const QQuickItem *parent = current->parentItem();
+        if (parent->flags().testFlag(QQuickItem::ItemHasContents)) {
+            return true;
+        }
+        const QList<QQuickItem *> siblings = parent->childItems();
+        const int index = siblings.indexOf(const_cast<QQuickItem *>(current));
+        for (int i = 0; i < siblings.size(); ++i) {
+            const QQuickItem *sibling = siblings.at(i);
+            if ((i != index) &&
+                ((sibling->z() < current->z()) ||
+                 ((sibling->z() == current->z()) && (i < index))) &&
+                drawsContent(sibling)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+QSize framebufferBucket(const QSize &size) {
+    const auto roundUp = [](int value) {
+        return qMax(((value + framebufferStep - 1) / framebufferStep) *
+                        framebufferStep,
+                    framebufferStep);
+    };
+    return {roundUp(size.width()), roundUp(size.height())};
+}
+
 } // namespace
 
+// Owns mpv's render context. Shared by the item and its scene graph, which
+// reports swaps to it on the render thread and may outlive the item, so that
+// it's only freed once neither uses it anymore.
+class MpvRenderContext {
+    Q_DISABLE_COPY_MOVE(MpvRenderContext)
+
+public:
+    // Keeps handle alive, mpv must not be destroyed before the context.
+    MpvRenderContext(const mpv::qt::Handle &handle,
+                     mpv_render_context *context)
+        : m_handle(handle), m_context(context) {}
+    ~MpvRenderContext() {
+        mpv_render_context_free(m_context);
+        if (m_freedHandler) {
+            m_freedHandler();
+        }
+    }
+
+    mpv_render_context *get() const { return m_context; }
+
+    // Called once the context has been freed, on whichever thread dropped
+    // the last reference. Only set it while holding a reference.
+    void setFreedHandler(const std::function<void()> &handler) {
+        m_freedHandler = handler;
+    }
+
+private:
+    mpv::qt::Handle m_handle;
+    mpv_render_context *m_context = nullptr;
+    std::function<void()> m_freedHandler;
+};
+
 class MpvRenderer : public QQuickFramebufferObject::Renderer {
     Q_DISABLE_COPY_MOVE(MpvRenderer)
 
@@ -40,52 +482,94 @@ public:
         : m_mpvDeclarativeObject(mpvDeclarativeObject) {
         Q_ASSERT(m_mpvDeclarativeObject != nullptr);
     }
-    ~MpvRenderer() override = default;
+    // The context is current here, the scene graph is torn down on the
+    // render thread.
+    ~MpvRenderer() override { releaseReadback(); }
+
+    void synchronize(QQuickFramebufferObject *item) override {
+        Q_UNUSED(item)
+        m_frameSink = m_mpvDeclarativeObject->frameReadback
+            ? m_mpvDeclarativeObject->frameSink
+            : nullptr;
+        if (m_frameSink == nullptr) {
+            releaseReadback();
+        }
+        // The video was drawn directly into the window in the meantime, the
+        // FBO holds an old frame.
+        if (m_mpvDeclarativeObject->framebufferStale) {
+            m_mpvDeclarativeObject->framebufferStale = false;
+            m_framebufferDirty = true;
+        }
+        if (m_renderSize != m_mpvDeclarativeObject->renderSize) {
+            m_renderSize = m_mpvDeclarativeObject->renderSize;
+            m_framebufferDirty = true;
+        }
+    }
 
-    // This function is called when a new FBO is needed.
-    // This happens on the initial frame.
+    // This function is called when a new FBO is needed. This happens on the
+    // initial frame, and once the item was resized out of the current FBO,
+    // see MpvDeclarativeObject::settleRenderSize().
     QOpenGLFramebufferObject *
     createFramebufferObject(const QSize &size) override {
-        // init mpv_gl:
-        if (m_mpvDeclarativeObject->mpv_gl == nullptr) {
-            mpv_opengl_init_params gl_init_params{get_proc_address_mpv, nullptr,
-                                                  nullptr};
-            mpv_render_param params[]{
-                {MPV_RENDER_PARAM_API_TYPE,
-                 const_cast<char *>(MPV_RENDER_API_TYPE_OPENGL)},
-                {MPV_RENDER_PARAM_OPENGL_INIT_PARAMS, &gl_init_params},
-                {MPV_RENDER_PARAM_INVALID, nullptr},
-                {MPV_RENDER_PARAM_INVALID, nullptr}};
-#if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
-            if (QGuiApplication::platformName().contains("xcb")) {
-                params[2].type = MPV_RENDER_PARAM_X11_DISPLAY;
-                params[2].data = QX11Info::display();
-            }
-#endif
-
-            const int mpvGLInitResult =
-                mpv_render_context_create(&m_mpvDeclarativeObject->mpv_gl,
-                                          m_mpvDeclarativeObject->mpv, params);
-            Q_ASSERT(mpvGLInitResult >= 0);
-            mpv_render_context_set_update_callback(
-                m_mpvDeclarativeObject->mpv_gl, on_mpv_redraw,
-                m_mpvDeclarativeObject);
-
-            QMetaObject::invokeMethod(m_mpvDeclarativeObject, "initFinished");
-        }
-
-        return QQuickFramebufferObject::Renderer::createFramebufferObject(size);
+        m_mpvDeclarativeObject->initializeRenderContext();
+        // The new FBO has undefined contents, draw into it even if mpv has
+        // no new frame.
+        m_framebufferDirty = true;
+        // Leave some room, so that small resizes don't need a new FBO.
+        const QSize target = m_renderSize.isEmpty() ? size : m_renderSize;
+        const QSize bucket =
+            (m_mpvDeclarativeObject->textureProviderRequested.loadAcquire() !=
+             0)
+            ? target
+            : framebufferBucket(target);
+        // Called during synchronization, while the GUI thread is blocked.
+        m_mpvDeclarativeObject->currentFramebufferSize = bucket;
+        QMetaObject::invokeMethod(m_mpvDeclarativeObject,
+                                  "framebufferSizeChanged",
+                                  Qt::QueuedConnection);
+        return QQuickFramebufferObject::Renderer::createFramebufferObject(
+            bucket);
     }
 
     void render() override {
+        // mpv may still be initializing on a worker thread. The item is
+        // updated again once it's done.
+        if (!m_mpvDeclarativeObject->initializeRenderContext()) {
+            return;
+        }
+        // The item is also updated for reasons that have nothing to do with
+        // the video, keep the last frame in the FBO unless mpv has a new one.
+        const quint64 flags =
+            mpv_render_context_update(m_mpvDeclarativeObject->mpv_gl);
+        if ((flags & MPV_RENDER_UPDATE_FRAME) != 0) {
+            m_framePending = true;
+        }
+        if (!m_framePending && !m_framebufferDirty) {
+            return;
+        }
+        // A frame that isn't due before the next vsync is shown on the next
+        // pass instead of blocking the render thread until its target time.
+        if (!m_framebufferDirty && frameIsEarly()) {
+            MpvDeclarativeObject::on_update(m_mpvDeclarativeObject);
+            return;
+        }
+        m_framePending = false;
+        m_framebufferDirty = false;
+
         m_mpvDeclarativeObject->window()->resetOpenGLState();
 
         QOpenGLFramebufferObject *fbo = framebufferObject();
+        // Only the part of the FBO matching the settled item size is drawn
+        // and shown, see MpvDeclarativeObject::updatePaintNode().
+        const QSize size = m_renderSize.isEmpty()
+            ? fbo->size()
+            : m_renderSize.boundedTo(fbo->size());
         mpv_opengl_fbo mpfbo{0, 0, 0, 0};
         mpfbo.fbo = static_cast<int>(fbo->handle());
-        mpfbo.w = fbo->width();
-        mpfbo.h = fbo->height();
+        mpfbo.w = size.width();
+        mpfbo.h = size.height();
         int flip_y{0};
+        int block_for_target_time{0};
 
         mpv_render_param params[] = {
             // Specify the default framebuffer (0) as target. This will
@@ -95,64 +579,873 @@ public:
             {MPV_RENDER_PARAM_OPENGL_FBO, &mpfbo},
             // Flip rendering (needed due to flipped GL coordinate system).
             {MPV_RENDER_PARAM_FLIP_Y, &flip_y},
+            // Waiting for the target time is done by deferring the frame to
+            // a later pass, see frameIsEarly().
+            {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &block_for_target_time},
             {MPV_RENDER_PARAM_INVALID, nullptr}};
         // See render_gl.h on what OpenGL environment mpv expects, and
         // other API details.
         mpv_render_context_render(m_mpvDeclarativeObject->mpv_gl, params);
 
         m_mpvDeclarativeObject->window()->resetOpenGLState();
+
+        if (m_frameSink != nullptr) {
+            readBack(fbo, size);
+            m_mpvDeclarativeObject->window()->resetOpenGLState();
+        }
+    }
+
+private:
+    struct ReadbackSlot {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        QSize size = {};
+        qint64 timestamp = 0;
+    };
+
+    // Queue a copy of the frame into the next PBO of the ring, and hand the
+    // ones the GPU has finished over to the sink. Nothing here waits for the
+    // GPU, frames arrive a few frames later instead.
+    void readBack(QOpenGLFramebufferObject *fbo, const QSize &size) {
+        QOpenGLContext *context = QOpenGLContext::currentContext();
+        // PBOs and fences need OpenGL (ES) 3.0.
+        if ((context == nullptr) ||
+            (context->format().majorVersion() < 3)) {
+            return;
+        }
+        QOpenGLExtraFunctions *f = context->extraFunctions();
+        deliverReadbackFrames(f);
+        ReadbackSlot &slot = m_readbackSlots[m_nextReadbackSlot];
+        if (slot.fence != nullptr) {
+            // The GPU is behind, don't make the render thread wait for it.
+            m_mpvDeclarativeObject->droppedReadbackFrames.ref();
+            notifyReadbackStatistics();
+            return;
+        }
+        if (slot.buffer == 0) {
+            f->glGenBuffers(1, &slot.buffer);
+        }
+        f->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        if (slot.size != size) {
+            f->glBufferData(GL_PIXEL_PACK_BUFFER,
+                            size.width() * size.height() * 4, nullptr,
+                            GL_STREAM_READ);
+            slot.size = size;
+        }
+        fbo->bind();
+        f->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        f->glReadPixels(0, 0, size.width(), size.height(), GL_RGBA,
+                        GL_UNSIGNED_BYTE, nullptr);
+        slot.fence = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.timestamp = mpv_get_time_us(m_mpvDeclarativeObject->mpv);
+        f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        fbo->release();
+        m_nextReadbackSlot = (m_nextReadbackSlot + 1) % readbackRingSize;
+    }
+
+    void deliverReadbackFrames(QOpenGLExtraFunctions *f) {
+        // Oldest first, so that frames arrive in order.
+        for (int i = 0; i < readbackRingSize; ++i) {
+            ReadbackSlot &slot =
+                m_readbackSlots[(m_nextReadbackSlot + i) % readbackRingSize];
+            if (slot.fence == nullptr) {
+                continue;
+            }
+            const GLenum status = f->glClientWaitSync(slot.fence, 0, 0);
+            if ((status != GL_ALREADY_SIGNALED) &&
+                (status != GL_CONDITION_SATISFIED)) {
+                return;
+            }
+            f->glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+            f->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            const int length = slot.size.width() * slot.size.height() * 4;
+            const auto *data = static_cast<const uchar *>(f->glMapBufferRange(
+                GL_PIXEL_PACK_BUFFER, 0, length, GL_MAP_READ_BIT));
+            if (data != nullptr) {
+                // mpv renders the top row first into the FBO, see flip_y.
+                const QImage frame(data, slot.size.width(),
+                                   slot.size.height(), slot.size.width() * 4,
+                                   QImage::Format_RGBA8888);
+                if (m_frameSink->frameReady(frame, slot.timestamp)) {
+                    m_mpvDeclarativeObject->readbackFrames.ref();
+                } else {
+                    m_mpvDeclarativeObject->droppedReadbackFrames.ref();
+                }
+                f->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                notifyReadbackStatistics();
+            }
+            f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    }
+
+    void notifyReadbackStatistics() {
+        QMetaObject::invokeMethod(m_mpvDeclarativeObject,
+                                  "readbackStatisticsChanged",
+                                  Qt::QueuedConnection);
+    }
+
+    void releaseReadback() {
+        QOpenGLContext *context = QOpenGLContext::currentContext();
+        if (context == nullptr) {
+            return;
+        }
+        QOpenGLExtraFunctions *f = context->extraFunctions();
+        for (ReadbackSlot &slot : m_readbackSlots) {
+            if (slot.fence != nullptr) {
+                f->glDeleteSync(slot.fence);
+            }
+            if (slot.buffer != 0) {
+                f->glDeleteBuffers(1, &slot.buffer);
+            }
+            slot = ReadbackSlot();
+        }
+        m_nextReadbackSlot = 0;
+    }
+
+    // Whether the next frame should be presented after the next vsync.
+    bool frameIsEarly() const {
+        const qint64 interval =
+            m_mpvDeclarativeObject->refreshInterval.loadAcquire();
+        if (interval <= 0) {
+            return false;
+        }
+        mpv_render_frame_info info{0, 0};
+        if (mpv_render_context_get_info(
+                m_mpvDeclarativeObject->mpv_gl,
+                {MPV_RENDER_PARAM_NEXT_FRAME_INFO, &info}) < 0) {
+            return false;
+        }
+        if (((info.flags & MPV_RENDER_FRAME_INFO_PRESENT) == 0) ||
+            ((info.flags & MPV_RENDER_FRAME_INFO_REDRAW) != 0) ||
+            (info.target_time <= 0)) {
+            return false;
+        }
+        // Late frames are rendered right away, mpv decides on dropping them
+        // from the reported swaps.
+        const qint64 now = mpv_get_time_us(m_mpvDeclarativeObject->mpv);
+        return (info.target_time - now) > interval;
+    }
+
+    MpvDeclarativeObject *m_mpvDeclarativeObject = nullptr;
+    bool m_framebufferDirty = true;
+    // mpv has a frame that hasn't been rendered yet.
+    bool m_framePending = false;
+    QSize m_renderSize;
+    MpvFrameSink *m_frameSink = nullptr;
+    ReadbackSlot m_readbackSlots[readbackRingSize];
+    int m_nextReadbackSlot = 0;
+};
+
+#ifdef MPV_RENDER_API_TYPE_SW
+// Renders mpv on the CPU with its software render API into a buffer that is
+// reused between frames, and shows it as a texture. Doesn't need OpenGL, so
+// it also works with Qt Quick's software backend.
+class MpvSoftwareNode;
+
+// Lets other items sample the frames of the software backend.
+class MpvSoftwareTextureProvider : public QSGTextureProvider {
+public:
+    MpvSoftwareTextureProvider(MpvSoftwareNode *node) : m_node(node) {}
+
+    QSGTexture *texture() const override;
+
+private:
+    MpvSoftwareNode *m_node = nullptr;
+};
+
+// Texture of the software backend with the OpenGL scene graph. It's allocated
+// once per size and each frame is uploaded into it.
+class MpvSoftwareTexture : public QSGTexture {
+    Q_DISABLE_COPY_MOVE(MpvSoftwareTexture)
+
+public:
+    explicit MpvSoftwareTexture(const QSize &size) : m_size(size) {}
+    ~MpvSoftwareTexture() override {
+        // Deleted by the node, on the render thread.
+        QOpenGLContext *context = QOpenGLContext::currentContext();
+        if ((m_id != 0) && (context != nullptr)) {
+            context->functions()->glDeleteTextures(1, &m_id);
+        }
+    }
+
+    int textureId() const override { return int(m_id); }
+    QSize textureSize() const override { return m_size; }
+    bool hasAlphaChannel() const override { return false; }
+    bool hasMipmaps() const override { return false; }
+
+    void bind() override {
+        QOpenGLContext::currentContext()->functions()->glBindTexture(
+            GL_TEXTURE_2D, m_id);
+        updateBindOptions();
+    }
+
+    // Copies the frame, nothing refers to it afterwards.
+    void upload(const QImage &frame) {
+        Q_ASSERT(frame.size() == m_size);
+        QOpenGLContext *context = QOpenGLContext::currentContext();
+        QOpenGLFunctions *f = context->functions();
+        const bool allocate = (m_id == 0);
+        if (allocate) {
+            f->glGenTextures(1, &m_id);
+        }
+        f->glBindTexture(GL_TEXTURE_2D, m_id);
+        if (allocate) {
+            f->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_size.width(),
+                            m_size.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                            nullptr);
+            updateBindOptions(true);
+        }
+        const int rowLength = frame.bytesPerLine() / 4;
+        if (rowLength == m_size.width()) {
+            f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_size.width(),
+                               m_size.height(), GL_RGBA, GL_UNSIGNED_BYTE,
+                               frame.constBits());
+        } else if (!context->isOpenGLES() ||
+                   (context->format().majorVersion() >= 3)) {
+            f->glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength);
+            f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_size.width(),
+                               m_size.height(), GL_RGBA, GL_UNSIGNED_BYTE,
+                               frame.constBits());
+            f->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        } else {
+            // OpenGL ES 2 can't skip the padding of the rows.
+            for (int y = 0; y != m_size.height(); ++y) {
+                f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, m_size.width(), 1,
+                                   GL_RGBA, GL_UNSIGNED_BYTE,
+                                   frame.constScanLine(y));
+            }
+        }
+        f->glBindTexture(GL_TEXTURE_2D, 0);
     }
 
 private:
+    GLuint m_id = 0;
+    QSize m_size;
+};
+
+class MpvSoftwareNode : public QSGSimpleTextureNode {
+    Q_DISABLE_COPY_MOVE(MpvSoftwareNode)
+
+public:
+    MpvSoftwareNode(MpvDeclarativeObject *mpvDeclarativeObject)
+        : m_mpvDeclarativeObject(mpvDeclarativeObject),
+          m_provider(new MpvSoftwareTextureProvider(this)) {
+        Q_ASSERT(m_mpvDeclarativeObject != nullptr);
+        Q_ASSERT(m_mpvDeclarativeObject->window() != nullptr);
+        m_openGL = (m_mpvDeclarativeObject->window()
+                        ->rendererInterface()
+                        ->graphicsApi() == QSGRendererInterface::OpenGL);
+        setFlag(QSGNode::UsePreprocess);
+        setOwnsTexture(true);
+        setFiltering(QSGTexture::Linear);
+        // The material needs a texture before mpv has drawn anything, e.g.
+        // while it's initializing asynchronously or when rendering fails.
+        QImage placeholder(1, 1, QImage::Format_RGB32);
+        placeholder.fill(Qt::black);
+        setTexture(m_mpvDeclarativeObject->window()->createTextureFromImage(
+            placeholder, QQuickWindow::TextureIsOpaque));
+    }
+    ~MpvSoftwareNode() override { delete m_provider; }
+
+    MpvSoftwareTextureProvider *provider() const { return m_provider; }
+
+    // Called from updatePaintNode(), while the GUI thread is blocked.
+    void synchronize(const QRectF &rect, const QSize &size) {
+        setRect(rect);
+        m_size = size;
+    }
+
+    // Runs on the render thread before each frame, without blocking the GUI
+    // thread like updatePaintNode() would.
+    void preprocess() override {
+        if (m_size.isEmpty() ||
+            !m_mpvDeclarativeObject->initializeRenderContext()) {
+            return;
+        }
+        const quint64 flags =
+            mpv_render_context_update(m_mpvDeclarativeObject->mpv_gl);
+        if (((flags & MPV_RENDER_UPDATE_FRAME) == 0) &&
+            (m_frames[m_frameIndex].size() == m_size)) {
+            return;
+        }
+        // The texture of the software scene graph shares its image until the
+        // next one replaces it, so the frames alternate between two buffers
+        // there. The OpenGL texture holds a copy, one buffer is enough.
+        const int index = m_openGL ? 0 : (m_frameIndex ^ 1);
+        QImage &frame = m_frames[index];
+        if (frame.size() != m_size) {
+            // If this fails, the buffer is kept at its size.
+            const QImage resized = allocateFrame(
+                m_size, m_openGL ? QImage::Format_RGBX8888
+                                 : QImage::Format_RGB32);
+            if (!resized.isNull()) {
+                frame = resized;
+            }
+        }
+        if (frame.isNull()) {
+            return;
+        }
+        // Only detaches if a texture still shares the buffer after all,
+        // instead of writing under it.
+        void *pixels = frame.bits();
+        size_t stride = size_t(frame.bytesPerLine());
+        int size[2]{frame.width(), frame.height()};
+        // Matches the byte order of the image format.
+        char rgbFormat[]{"rgb0"};
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        char imageFormat[]{"bgr0"};
+#else
+        char imageFormat[]{"0rgb"};
+#endif
+        int block_for_target_time{0};
+        mpv_render_param params[]{
+            {MPV_RENDER_PARAM_SW_SIZE, size},
+            {MPV_RENDER_PARAM_SW_FORMAT, m_openGL ? rgbFormat : imageFormat},
+            {MPV_RENDER_PARAM_SW_STRIDE, &stride},
+            {MPV_RENDER_PARAM_SW_POINTER, pixels},
+            {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &block_for_target_time},
+            {MPV_RENDER_PARAM_INVALID, nullptr}};
+        if (mpv_render_context_render(m_mpvDeclarativeObject->mpv_gl,
+                                      params) < 0) {
+            return;
+        }
+        m_frameIndex = index;
+        if (m_openGL) {
+            // Replaces the placeholder, then textures of other sizes.
+            if ((m_frameTexture == nullptr) ||
+                (m_frameTexture->textureSize() != frame.size())) {
+                m_frameTexture = new MpvSoftwareTexture(frame.size());
+                setTexture(m_frameTexture);
+            }
+            m_frameTexture->upload(frame);
+        } else {
+            // The software scene graph has no texture to update, it draws
+            // from a pixmap sharing the image.
+            setTexture(m_mpvDeclarativeObject->window()->createTextureFromImage(
+                frame, QQuickWindow::TextureIsOpaque));
+        }
+        markDirty(QSGNode::DirtyMaterial);
+        Q_EMIT m_provider->textureChanged();
+    }
+
+private:
+    // Rows aligned for SIMD, which makes mpv faster. The buffer is freed
+    // along with the last image that shares it.
+    static QImage allocateFrame(const QSize &size, QImage::Format format) {
+        const int stride = (size.width() * 4 + 63) & ~63;
+        void *data = qMallocAligned(size_t(stride) * size_t(size.height()), 64);
+        if (data == nullptr) {
+            return {};
+        }
+        return QImage(
+            static_cast<uchar *>(data), size.width(), size.height(), stride,
+            format, [](void *info) { qFreeAligned(info); }, data);
+    }
+
     MpvDeclarativeObject *m_mpvDeclarativeObject = nullptr;
+    MpvSoftwareTextureProvider *m_provider = nullptr;
+    // The scene graph uses OpenGL, frames are uploaded to MpvSoftwareTexture.
+    bool m_openGL = false;
+    // Owned by the node once set.
+    MpvSoftwareTexture *m_frameTexture = nullptr;
+    QSize m_size;
+    QImage m_frames[2];
+    // Of the last frame rendered.
+    int m_frameIndex = 0;
+};
+
+QSGTexture *MpvSoftwareTextureProvider::texture() const {
+    return m_node->texture();
+}
+#endif
+
+// Root of the item's subtree. Holds the node of the current rendering path,
+// the others are kept detached so that switching back is cheap.
+//
+// Also renders mpv straight into the window's render target when rendering
+// directly, without the FBO of QQuickFramebufferObject. That happens on
+// QQuickWindow::beforeRendering(), underneath the whole scene, so items
+// stacked above the player are drawn over the video. mpv always draws the
+// whole target, so this is only used while the item covers the entire window
+// and nothing is drawn below it, see canRenderDirectly().
+class MpvRootNode : public QSGNode {
+    Q_DISABLE_COPY_MOVE(MpvRootNode)
+
+public:
+    MpvRootNode(QQuickWindow *window) : m_window(window) {
+        Q_ASSERT(m_window != nullptr);
+        // Both are emitted on the render thread, which also deletes the
+        // scene graph. Neither runs anymore once this node is gone.
+        m_beforeRenderingConnection =
+            QObject::connect(m_window, &QQuickWindow::beforeRendering,
+                             [this]() { renderDirectly(); });
+        // Right after the scene graph presented.
+        m_swapConnection =
+            QObject::connect(m_window, &QQuickWindow::frameSwapped, [this]() {
+                if (m_renderContext != nullptr) {
+                    mpv_render_context_report_swap(m_renderContext->get());
+                }
+            });
+    }
+    ~MpvRootNode() override {
+        QObject::disconnect(m_beforeRenderingConnection);
+        QObject::disconnect(m_swapConnection);
+        // Detached nodes aren't deleted along with the children.
+        if ((framebufferNode != nullptr) &&
+            (framebufferNode->parent() == nullptr)) {
+            delete framebufferNode;
+        }
+        if ((softwareNode != nullptr) && (softwareNode->parent() == nullptr)) {
+            delete softwareNode;
+        }
+    }
+
+    // Called from updatePaintNode(), while the GUI thread is blocked. Holds
+    // on to the render context, which is freed here on the render thread if
+    // the item is gone already.
+    void setRenderContext(const QSharedPointer<MpvRenderContext> &context) {
+        m_renderContext = context;
+    }
+
+    // Called from updatePaintNode(), while the GUI thread is blocked. An
+    // empty size stops rendering directly.
+    void setDirectTargetSize(const QSize &size) { m_directTargetSize = size; }
+
+    // Owned by QQuickFramebufferObject, which hands out the same node as
+    // long as the scene graph is alive.
+    QSGNode *framebufferNode = nullptr;
+    QSGNode *softwareNode = nullptr;
+
+private:
+    void renderDirectly() {
+        if (m_directTargetSize.isEmpty()) {
+            return;
+        }
+        m_window->resetOpenGLState();
+        QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+        // mpv is still initializing. The window isn't cleared by the scene
+        // graph while rendering directly, don't show garbage meanwhile.
+        if (m_renderContext == nullptr) {
+            f->glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            f->glClear(GL_COLOR_BUFFER_BIT);
+            return;
+        }
+        // The window is redrawn from scratch on every frame, so there's no
+        // previous frame to keep: always draw, whether a new one is due or not.
+        mpv_render_context_update(m_renderContext->get());
+
+        GLint target = 0;
+        f->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &target);
+        mpv_opengl_fbo mpfbo{static_cast<int>(target),
+                             m_directTargetSize.width(),
+                             m_directTargetSize.height(), 0};
+        // Unlike the FBO, the window isn't sampled as a texture afterwards.
+        int flip_y{1};
+        int block_for_target_time{0};
+        mpv_render_param params[] = {
+            {MPV_RENDER_PARAM_OPENGL_FBO, &mpfbo},
+            {MPV_RENDER_PARAM_FLIP_Y, &flip_y},
+            {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &block_for_target_time},
+            {MPV_RENDER_PARAM_INVALID, nullptr}};
+        mpv_render_context_render(m_renderContext->get(), params);
+
+        m_window->resetOpenGLState();
+    }
+
+    QQuickWindow *m_window = nullptr;
+    QSharedPointer<MpvRenderContext> m_renderContext;
+    QSize m_directTargetSize;
+    QMetaObject::Connection m_beforeRenderingConnection;
+    QMetaObject::Connection m_swapConnection;
 };
 
+// Called on the render thread by whichever path draws first.
+bool MpvDeclarativeObject::initializeRenderContext() {
+    if (mpv_gl != nullptr) {
+        return true;
+    }
+    if ((mpvReady.loadAcquire() == 0) ||
+        (renderContextError.loadAcquire() != 0)) {
+        return false;
+    }
+#ifdef MPV_RENDER_API_TYPE_SW
+    if (resolvedRenderBackend == RenderBackend::Software) {
+        int advanced_control{1};
+        mpv_render_param params[]{
+            {MPV_RENDER_PARAM_API_TYPE,
+             const_cast<char *>(MPV_RENDER_API_TYPE_SW)},
+            {MPV_RENDER_PARAM_ADVANCED_CONTROL, &advanced_control},
+            {MPV_RENDER_PARAM_INVALID, nullptr}};
+        const int mpvSWInitResult =
+            mpv_render_context_create(&mpv_gl, mpv, params);
+        if (mpvSWInitResult < 0) {
+            failRenderContext(RenderBackend::Software, mpvSWInitResult);
+            return false;
+        }
+        renderContext.reset(new MpvRenderContext(mpv, mpv_gl));
+        mpv_render_context_set_update_callback(mpv_gl, on_mpv_redraw, this);
+        QMetaObject::invokeMethod(this, "initFinished");
+        return true;
+    }
+#endif
+    mpv_opengl_init_params gl_init_params{get_proc_address_mpv, nullptr,
+                                          nullptr};
+    // Let mpv schedule the frames itself. This requires calling
+    // mpv_render_context_update() on each update callback, see the renderers.
+    int advanced_control{1};
+    mpv_render_param params[]{
+        {MPV_RENDER_PARAM_API_TYPE,
+         const_cast<char *>(MPV_RENDER_API_TYPE_OPENGL)},
+        {MPV_RENDER_PARAM_OPENGL_INIT_PARAMS, &gl_init_params},
+        {MPV_RENDER_PARAM_ADVANCED_CONTROL, &advanced_control},
+        {MPV_RENDER_PARAM_INVALID, nullptr},
+        {MPV_RENDER_PARAM_INVALID, nullptr}};
+#if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
+    if (QGuiApplication::platformName().contains("xcb")) {
+        params[3].type = MPV_RENDER_PARAM_X11_DISPLAY;
+        params[3].data = QX11Info::display();
+    }
+#endif
+
+    const int mpvGLInitResult = mpv_render_context_create(&mpv_gl, mpv, params);
+    if (mpvGLInitResult < 0) {
+        failRenderContext(RenderBackend::OpenGL, mpvGLInitResult);
+        return false;
+    }
+    renderContext.reset(new MpvRenderContext(mpv, mpv_gl));
+    mpv_render_context_set_update_callback(mpv_gl, on_mpv_redraw, this);
+
+    QMetaObject::invokeMethod(this, "initFinished");
+    return true;
+}
+
+void MpvDeclarativeObject::failRenderContext(
+    MpvDeclarativeObject::RenderBackend backend, int errorCode) {
+    mpv_gl = nullptr;
+    renderContextError.storeRelease(errorCode);
+    QMetaObject::invokeMethod(
+        this,
+        [this, backend, errorCode]() {
+            renderContextFailed(backend, errorCode);
+        },
+        Qt::QueuedConnection);
+}
+
+void MpvDeclarativeObject::renderContextFailed(
+    MpvDeclarativeObject::RenderBackend backend, int errorCode) {
+    qCritical().noquote() << "Failed to create the render context of mpv:"
+                          << QString::fromUtf8(mpv_error_string(errorCode));
+#ifdef MPV_RENDER_API_TYPE_SW
+    const QSGRendererInterface *rif =
+        (window() != nullptr) ? window()->rendererInterface() : nullptr;
+    if ((backend == RenderBackend::Software) &&
+        (currentRenderBackend == RenderBackend::Automatic) &&
+        (rif != nullptr) &&
+        (rif->graphicsApi() == QSGRendererInterface::OpenGL)) {
+        qWarning().noquote() << "Falling back to the OpenGL render backend.";
+        // Switched over in updatePaintNode(), which also clears the error.
+        softwareBackendFailed = true;
+        update();
+        return;
+    }
+#else
+    Q_UNUSED(backend)
+#endif
+    // Nothing can be shown, don't keep playing in the background.
+    mpvSendCommand({QStringLiteral("stop")});
+    mpvInitState = MpvInitState::Failed;
+    Q_EMIT initFailed(errorCode);
+}
+
 MpvDeclarativeObject::MpvDeclarativeObject(QQuickItem *parent)
     : QQuickFramebufferObject(parent),
       mpv(mpv::qt::Handle::FromRawHandle(mpv_create())) {
+    // May be swapped for a pooled handle in mpvInitialize(), once the
+    // options are known.
     Q_ASSERT(mpv != nullptr);
 
-    mpvSetProperty(QLatin1String("input-default-bindings"), false);
-    mpvSetProperty(QLatin1String("input-vo-keyboard"), false);
-    mpvSetProperty(QLatin1String("input-cursor"), false);
-    mpvSetProperty(QLatin1String("cursor-autohide"), false);
-
-    auto iterator = properties.constBegin();
-    while (iterator != properties.constEnd()) {
-        mpvObserveProperty(QLatin1String(iterator.key()));
-        ++iterator;
+    mpvSetProperty<bool>(QLatin1String("input-default-bindings"), false);
+    mpvSetProperty<bool>(QLatin1String("input-vo-keyboard"), false);
+    mpvSetProperty<bool>(QLatin1String("input-cursor"), false);
+    mpvSetProperty<bool>(QLatin1String("cursor-autohide"), false);
+    screenshotPool.setMaxThreadCount(2);
+    // The FBO is managed by the renderer and settleRenderSize().
+    setTextureFollowsItemSize(false);
+    resizeTimer.setSingleShot(true);
+    resizeTimer.setInterval(resizeSettleDelay);
+    connect(&resizeTimer, &QTimer::timeout, this,
+            &MpvDeclarativeObject::settleRenderSize);
+    // Time frames by the display, from the swaps reported on frameSwapped().
+    // Only a default: it's staged, and so replaced by a videoSync from QML.
+    mpvSetProperty<QString>(QLatin1String("video-sync"),
+                            QStringLiteral("display-resample"));
+    connect(this, &QQuickItem::windowChanged, this,
+            &MpvDeclarativeObject::handleWindowChanged);
+
+    propertyCache.resize(mpvPropertyCount);
+    propertyThrottles.resize(mpvPropertyCount);
+    coalescedSlots.resize(static_cast<int>(CoalescedRequest::Count));
+    for (const MpvNotificationRate &rate : defaultNotificationRates) {
+        propertyThrottles[static_cast<int>(rate.property)].rate = rate.rate;
+    }
+    notifyClock.start();
+    throttleTimer.setSingleShot(true);
+    throttleTimer.setTimerType(Qt::PreciseTimer);
+    connect(&throttleTimer, &QTimer::timeout, this, [this]() {
+        flushThrottledProperties();
+        emitPendingPropertySignals();
+    });
+    for (const MpvProperty property : alwaysObservedProperties) {
+        setPropertyObserved(static_cast<int>(property), true);
     }
 
     // From this point on, the wakeup function will be called. The callback
     // can come from any thread, so we use the QueuedConnection mechanism to
     // relay the wakeup in a thread-safe way.
+    // hasMpvEvents() itself is always delivered through a queued invocation
+    // (see on_wakeup()), so no need to queue a second time here.
     connect(this, &MpvDeclarativeObject::hasMpvEvents, this,
-            &MpvDeclarativeObject::handleMpvEvents, Qt::QueuedConnection);
+            &MpvDeclarativeObject::handleMpvEvents, Qt::DirectConnection);
     mpv_set_wakeup_callback(mpv, wakeup, this);
 
-    const int mpvInitResult = mpv_initialize(mpv);
-    Q_ASSERT(mpvInitResult >= 0);
-
     connect(this, &MpvDeclarativeObject::onUpdate, this,
             &MpvDeclarativeObject::doUpdate, Qt::QueuedConnection);
+
+    // Items created from C++ never get componentComplete(), initialize them
+    // once control returns to the event loop.
+    QMetaObject::invokeMethod(
+        this,
+        [this]() {
+            if (isComponentComplete()) {
+                mpvInitialize();
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+void MpvDeclarativeObject::componentComplete() {
+    QQuickFramebufferObject::componentComplete();
+    mpvInitialize();
+}
+
+void MpvDeclarativeObject::mpvInitialize() {
+    if (mpvInitState != MpvInitState::Staging) {
+        return;
+    }
+    // Already initialized, the options are applied at runtime instead.
+    if (adoptPooledHandle()) {
+        mpvInitState = MpvInitState::Initializing;
+        mpvInitialized(0);
+        return;
+    }
+    // Options given before initialization are applied by mpv as if they came
+    // from the command line, without reinitializing the VO or AO later.
+    for (const auto &option : qAsConst(stagedOptions)) {
+        const int errorCode =
+            mpv::qt::set_option(mpv, option.first, option.second, &nodeArena);
+        if (errorCode < 0) {
+            qWarning().noquote()
+                << "Failed to set an option for mpv:" << option.first;
+        }
+    }
+    stagedOptions.clear();
+    mpvInitState = MpvInitState::Initializing;
+    if (!asynchronousInitialization()) {
+        mpvInitialized(mpv_initialize(mpv));
+        return;
+    }
+    // The thread holds its own reference, the handle outlives this object if
+    // it is destroyed in the meantime.
+    const mpv::qt::Handle handle = mpv;
+    const auto result = QSharedPointer<int>::create(MPV_ERROR_UNINITIALIZED);
+    QThread *thread = QThread::create(
+        [handle, result]() { *result = mpv_initialize(handle); });
+    connect(thread, &QThread::finished, this,
+            [this, result]() { mpvInitialized(*result); });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+}
+
+bool MpvDeclarativeObject::adoptPooledHandle() {
+    for (const auto &option : qAsConst(stagedOptions)) {
+        if (isInitOnlyOption(option.first)) {
+            qDebug().noquote() << "Not taking a pooled mpv handle, this option"
+                               << "only applies at startup:" << option.first;
+            return false;
+        }
+    }
+    const mpv::qt::Handle handle = mpv::qt::handle_pool::instance().acquire();
+    if (handle == nullptr) {
+        return false;
+    }
+    // The handle created in the constructor was never initialized, so it's
+    // cheap to destroy. Move what was set up on it over to the pooled one.
+    mpv_set_wakeup_callback(mpv, nullptr, nullptr);
+    mpv = handle;
+    for (int i = 0; i < propertyCache.size(); ++i) {
+        if (propertyCache.at(i).observed) {
+            mpv_observe_property(mpv, i + 1, mpvProperties[i].name,
+                                 mpvProperties[i].format);
+        }
+    }
+    if (!logMessageLevel.isEmpty()) {
+        mpv_request_log_messages(mpv, logMessageLevel.constData());
+    }
+    mpv_set_wakeup_callback(mpv, wakeup, this);
+    return true;
+}
+
+void MpvDeclarativeObject::mpvInitialized(int errorCode) {
+    if (errorCode < 0) {
+        qCritical().noquote() << "Failed to initialize mpv:"
+                              << QString::fromUtf8(mpv_error_string(errorCode));
+        // mpvReady stays unset, so no render context is ever created for
+        // the handle. Whatever was waiting for mpv is dropped.
+        mpvInitState = MpvInitState::Failed;
+        stagedOptions.clear();
+        stagedCommands.clear();
+        Q_EMIT initFailed(errorCode);
+        return;
+    }
+    mpvInitState = MpvInitState::Initialized;
+    mpvReady.storeRelease(1);
+    // Whatever was set while mpv_initialize() was running on the worker
+    // thread is applied at runtime.
+    const QVector<QPair<QString, QVariant>> options = stagedOptions;
+    stagedOptions.clear();
+    for (const auto &option : options) {
+        mpvSetProperty(option.first, option.second);
+    }
+    const QVariantList commands = stagedCommands;
+    stagedCommands.clear();
+    for (const QVariant &command : commands) {
+        mpvSendCommandNode(command);
+    }
+    updatePlaybackSnapshot();
+    update();
+}
+
+MpvDeclarativeObject::MpvRequestRoute
+MpvDeclarativeObject::stageOption(const QString &name, const QVariant &value) {
+    if (mpvInitState == MpvInitState::Initialized) {
+        return MpvRequestRoute::Send;
+    }
+    if (mpvInitState == MpvInitState::Failed) {
+        qWarning().noquote()
+            << "mpv failed to initialize, not setting:" << name;
+        return MpvRequestRoute::Refused;
+    }
+    qDebug().noquote() << "Staging an option for mpv:" << name
+                       << "to:" << value;
+    changedOptions.insert(name);
+    for (auto &option : stagedOptions) {
+        if (option.first == name) {
+            option.second = value;
+            return MpvRequestRoute::Staged;
+        }
+    }
+    stagedOptions.append(qMakePair(name, value));
+    return MpvRequestRoute::Staged;
+}
+
+MpvDeclarativeObject::MpvRequestRoute
+MpvDeclarativeObject::stageCommand(const QVariant &arguments) {
+    if (mpvInitState == MpvInitState::Initialized) {
+        return MpvRequestRoute::Send;
+    }
+    if (mpvInitState == MpvInitState::Failed) {
+        qWarning().noquote() << "mpv failed to initialize, not running:"
+                             << commandName(arguments);
+        return MpvRequestRoute::Refused;
+    }
+    const QStringList list = arguments.toStringList();
+    if ((list.size() == 3) && (list.constFirst() == QLatin1String("set"))) {
+        return stageOption(list.at(1), list.at(2));
+    }
+    qDebug().noquote() << "Staging a command for mpv:" << arguments;
+    stagedCommands.append(arguments);
+    return MpvRequestRoute::Staged;
 }
 
 MpvDeclarativeObject::~MpvDeclarativeObject() {
-    // only initialized if something got drawn
+    // Screenshots already being encoded are finished by the pool's
+    // destructor, the queued ones aren't worth waiting for.
+    screenshotPool.clear();
+    restoreWindowClearing();
+    // Don't leave C++ callers waiting on a reply that will never come.
+    for (PendingPropertyGet &request : pendingPropertyGets) {
+        if (request.promise.isStarted()) {
+            request.promise.reportCanceled();
+            request.promise.reportFinished();
+        }
+    }
+    // The handle may outlive us while it's being initialized.
+    mpv_set_wakeup_callback(mpv, nullptr, nullptr);
+    // only initialized if something got drawn. The scene graph may still be
+    // reporting swaps to it, it's freed along with the last of its nodes on
+    // the render thread then, see MpvRootNode.
     if (mpv_gl != nullptr) {
-        mpv_render_context_free(mpv_gl);
+        mpv_render_context_set_update_callback(mpv_gl, nullptr, nullptr);
+    }
+    // Hand the handle over to the next player if the pool has room for it.
+    // Stopping playback and restoring the options blocks, so it's done on a
+    // worker thread, which also destroys the handle if it isn't kept. A
+    // handle can't have two render contexts, so wait for this one to go.
+    if ((mpvInitState == MpvInitState::Initialized) &&
+        (mpv::qt::handle_pool::instance().capacity() > 0) &&
+        !QCoreApplication::closingDown()) {
+        QVector<quint64> observedIds;
+        for (int i = 0; i < propertyCache.size(); ++i) {
+            if (propertyCache.at(i).observed) {
+                observedIds.append(quint64(i) + 1);
+            }
+        }
+        const mpv::qt::Handle handle = mpv;
+        const QStringList options = changedOptions.values();
+        const auto release = [handle, observedIds, options]() {
+            QThreadPool::globalInstance()->start([handle, observedIds,
+                                                  options]() {
+                for (const quint64 id : observedIds) {
+                    mpv_unobserve_property(handle, id);
+                }
+                mpv::qt::handle_pool::instance().release(handle, options);
+            });
+        };
+        if (renderContext != nullptr) {
+            renderContext->setFreedHandler(release);
+        } else {
+            release();
+        }
     }
+    renderContext.reset();
     // We don't need to destroy mpv handle in our own because we are using
     // mpv::qt::Handle, which is a shared pointer.
     // mpv_terminate_destroy(mpv);
 }
 
 void MpvDeclarativeObject::on_update(void *ctx) {
-    Q_EMIT static_cast<MpvDeclarativeObject *>(ctx)->onUpdate();
+    auto *object = static_cast<MpvDeclarativeObject *>(ctx);
+    // One pending update() is enough no matter how many redraws mpv asks for.
+    if (object->updatePending.testAndSetOrdered(0, 1)) {
+        Q_EMIT object->onUpdate();
+    }
+}
+
+void MpvDeclarativeObject::on_wakeup(void *ctx) {
+    auto *object = static_cast<MpvDeclarativeObject *>(ctx);
+    // Only post a new drain if none is queued yet, handleMpvEvents() reads
+    // everything that arrived in the meantime anyway.
+    if (object->mpvEventsPending.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(object, "hasMpvEvents", Qt::QueuedConnection);
+    }
 }
 
 // connected to onUpdate() signal makes sure it runs on the GUI thread
-void MpvDeclarativeObject::doUpdate() { update(); }
+void MpvDeclarativeObject::doUpdate() {
+    updatePending.storeRelease(0);
+    update();
+}
 
 void MpvDeclarativeObject::processMpvLogMessage(mpv_event_log_message *event) {
     const QString logMessage =
@@ -184,37 +1477,332 @@ void MpvDeclarativeObject::processMpvLogMessage(mpv_event_log_message *event) {
     }
 }
 
-void MpvDeclarativeObject::processMpvPropertyChange(mpv_event_property *event) {
-    const char *eventName = event->name;
-    if (!propertyBlackList.contains(QString::fromUtf8(eventName),
-                                    Qt::CaseInsensitive)) {
+const MpvDeclarativeObject::CachedProperty &
+MpvDeclarativeObject::cachedProperty(MpvProperty property) const {
+    const int index = static_cast<int>(property);
+    CachedProperty &cached = propertyCache[index];
+    if (cached.valid) {
+        return cached;
+    }
+    // The initial change event hasn't been processed yet, or nothing is
+    // observing the property. Query it in its native format, later reads
+    // will hit the cache if it's observed.
+    // Don't bother mpv before it's initialized, defaults are fine until then.
+    if (mpvInitState != MpvInitState::Initialized) {
+        cached.format = MPV_FORMAT_NONE;
+        return cached;
+    }
+    const MpvPropertyInfo &info = mpvProperties[index];
+    int errorCode = MPV_ERROR_PROPERTY_UNAVAILABLE;
+    switch (info.format) {
+    case MPV_FORMAT_DOUBLE:
+        errorCode = mpv::qt::get<double>(mpv, info.name, &cached.doubleValue);
+        break;
+    case MPV_FORMAT_INT64:
+        errorCode = mpv::qt::get<qint64>(mpv, info.name, &cached.int64Value);
+        break;
+    case MPV_FORMAT_FLAG:
+        errorCode = mpv::qt::get<bool>(mpv, info.name, &cached.flagValue);
+        break;
+    case MPV_FORMAT_STRING:
+        errorCode =
+            mpv::qt::get<QString>(mpv, info.name, &cached.stringValue);
+        break;
+    case MPV_FORMAT_NODE: {
+        const QVariant value = mpvGetProperty(QLatin1String(info.name));
+        if (!mpv::qt::is_error(value)) {
+            cached.nodeValue = value;
+            errorCode = 0;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    cached.format = (errorCode >= 0) ? info.format : MPV_FORMAT_NONE;
+    cached.valid = cached.observed;
+    return cached;
+}
+
+template <>
+double MpvDeclarativeObject::mpvCachedProperty<double>(
+    MpvProperty property) const {
+    const CachedProperty &cached = cachedProperty(property);
+    switch (cached.format) {
+    case MPV_FORMAT_DOUBLE:
+        return cached.doubleValue;
+    case MPV_FORMAT_INT64:
+        return static_cast<double>(cached.int64Value);
+    default:
+        return 0.0;
+    }
+}
+
+template <>
+qint64 MpvDeclarativeObject::mpvCachedProperty<qint64>(
+    MpvProperty property) const {
+    const CachedProperty &cached = cachedProperty(property);
+    switch (cached.format) {
+    case MPV_FORMAT_INT64:
+        return cached.int64Value;
+    case MPV_FORMAT_DOUBLE:
+        return qRound64(cached.doubleValue);
+    default:
+        return 0;
+    }
+}
+
+template <>
+bool MpvDeclarativeObject::mpvCachedProperty<bool>(
+    MpvProperty property) const {
+    const CachedProperty &cached = cachedProperty(property);
+    return (cached.format == MPV_FORMAT_FLAG) ? cached.flagValue : false;
+}
+
+template <>
+QString MpvDeclarativeObject::mpvCachedProperty<QString>(
+    MpvProperty property) const {
+    const CachedProperty &cached = cachedProperty(property);
+    return (cached.format == MPV_FORMAT_STRING) ? cached.stringValue
+                                                : QString();
+}
+
+template <>
+QVariant MpvDeclarativeObject::mpvCachedProperty<QVariant>(
+    MpvProperty property) const {
+    const CachedProperty &cached = cachedProperty(property);
+    switch (cached.format) {
+    case MPV_FORMAT_NODE:
+        return cached.nodeValue;
+    case MPV_FORMAT_DOUBLE:
+        return cached.doubleValue;
+    case MPV_FORMAT_INT64:
+        return cached.int64Value;
+    case MPV_FORMAT_FLAG:
+        return cached.flagValue;
+    case MPV_FORMAT_STRING:
+        return cached.stringValue;
+    default:
+        return QVariant();
+    }
+}
+
+void MpvDeclarativeObject::processMpvPropertyChange(
+    quint64 id, mpv_event_property *event) {
+    // Not one of ours.
+    if ((id < 1) || (id > quint64(mpvPropertyCount))) {
+        return;
+    }
+    const int index = static_cast<int>(id - 1);
+    // Queued before the property was unobserved.
+    if (!propertyCache[index].observed) {
+        return;
+    }
+    const MpvPropertyInfo &info = mpvProperties[index];
+    if (!info.quiet) {
         qDebug().noquote() << "[libmpv] Property changed from mpv:"
-                           << eventName;
+                           << info.name;
+    }
+    // MPV_FORMAT_NONE means the property became unavailable (e.g. time-pos
+    // after the file was unloaded). Keep it marked as valid with an empty
+    // value so the getters don't fall back to querying mpv.
+    CachedProperty &cached = propertyCache[index];
+    cached.format = event->format;
+    switch (event->format) {
+    case MPV_FORMAT_DOUBLE:
+        cached.doubleValue = *static_cast<double *>(event->data);
+        break;
+    case MPV_FORMAT_INT64:
+        cached.int64Value = *static_cast<int64_t *>(event->data);
+        break;
+    case MPV_FORMAT_FLAG:
+        cached.flagValue = (*static_cast<int *>(event->data) != 0);
+        break;
+    case MPV_FORMAT_STRING:
+        cached.stringValue =
+            QString::fromUtf8(*static_cast<char **>(event->data));
+        break;
+    case MPV_FORMAT_NODE:
+        cached.nodeValue =
+            mpv::qt::node_to_variant(static_cast<mpv_node *>(event->data));
+        break;
+    default:
+        cached.format = MPV_FORMAT_NONE;
+        break;
+    }
+    cached.valid = true;
+    if (info.notifySignal == nullptr) {
+        return;
+    }
+    PropertyThrottle &throttle = propertyThrottles[index];
+    if (throttle.rate != 0.0) {
+        // Only the latest value matters, it's in the cache already. Notify
+        // right away if the property has been quiet for long enough,
+        // otherwise let flushThrottledProperties() pick it up.
+        const qint64 now = notifyClock.nsecsElapsed();
+        if (now - throttle.lastNotified < notifyInterval(index)) {
+            throttle.pending = true;
+            return;
+        }
+        throttle.pending = false;
+        throttle.lastNotified = now;
+    }
+    queuePropertySignal(info.notifySignal);
+}
+
+void MpvDeclarativeObject::queuePropertySignal(
+    void (MpvDeclarativeObject::*notifySignal)()) {
+    // Notify once the whole batch is processed and the playback snapshot is
+    // up to date, otherwise bindings would read stale values.
+    if (!pendingPropertySignals.contains(notifySignal)) {
+        pendingPropertySignals.append(notifySignal);
+    }
+}
+
+void MpvDeclarativeObject::handleWindowChanged(QQuickWindow *window) {
+    disconnect(screenChangedConnection);
+    restoreWindowClearing();
+    trackRenderingPathChanges();
+    if (window == nullptr) {
+        return;
+    }
+    // Swaps are reported by the scene graph, see MpvRootNode.
+    screenChangedConnection =
+        connect(window, &QWindow::screenChanged, this,
+                &MpvDeclarativeObject::updateDisplayRefreshRate);
+    updateDisplayRefreshRate(window->screen());
+}
+
+void MpvDeclarativeObject::updateDisplayRefreshRate(QScreen *screen) {
+    const qreal rate = (screen != nullptr) ? screen->refreshRate() : 0.0;
+    if (rate <= 0.0) {
+        refreshInterval.storeRelease(0);
+        return;
+    }
+    refreshInterval.storeRelease(qint64(1000000.0 / rate));
+    // mpv can't query the display through the render API.
+    // Renamed in mpv 0.37, whose client API is 2.2.
+#if MPV_CLIENT_API_VERSION >= MPV_MAKE_VERSION(2, 2)
+    mpvSetProperty<double>(QLatin1String("override-display-fps"), rate);
+#else
+    mpvSetProperty<double>(QLatin1String("display-fps"), rate);
+#endif
+}
+
+qint64 MpvDeclarativeObject::notifyInterval(int index) const {
+    qreal rate = propertyThrottles.at(index).rate;
+    if (rate == 0.0) {
+        return 0;
     }
-    if (properties.contains(eventName)) {
-        const auto signalName = properties.value(eventName);
-        if (signalName != nullptr) {
-            QMetaObject::invokeMethod(this, signalName);
+    if (rate < 0.0) {
+        const QScreen *screen =
+            (window() != nullptr) ? window()->screen() : nullptr;
+        rate = (screen != nullptr) ? screen->refreshRate() : 60.0;
+    }
+    return (rate > 0.0) ? qint64(1000000000.0 / rate) : 0;
+}
+
+void MpvDeclarativeObject::flushThrottledProperties() {
+    const qint64 now = notifyClock.nsecsElapsed();
+    qint64 nextDeadline = -1;
+    for (int i = 0; i < propertyThrottles.size(); ++i) {
+        PropertyThrottle &throttle = propertyThrottles[i];
+        if (!throttle.pending) {
+            continue;
+        }
+        const qint64 deadline = throttle.lastNotified + notifyInterval(i);
+        if (now >= deadline) {
+            throttle.pending = false;
+            throttle.lastNotified = now;
+            queuePropertySignal(mpvProperties[i].notifySignal);
+        } else if ((nextDeadline < 0) || (deadline < nextDeadline)) {
+            nextDeadline = deadline;
+        }
+    }
+    if (nextDeadline >= 0) {
+        // Round up, firing early would only re-arm the timer.
+        throttleTimer.start(int((nextDeadline - now + 999999) / 1000000));
+    }
+}
+
+void MpvDeclarativeObject::emitPendingPropertySignals() {
+    // Take a copy, the signal handlers may trigger another batch. Only the
+    // properties of unfinished batches wait, the others go out right away.
+    QVector<NotifySignal> notifySignals;
+    QVector<NotifySignal> heldBackSignals;
+    for (const NotifySignal notifySignal : qAsConst(pendingPropertySignals)) {
+        if (isPropertySignalHeldBack(notifySignal)) {
+            heldBackSignals.append(notifySignal);
+        } else {
+            notifySignals.append(notifySignal);
+        }
+    }
+    pendingPropertySignals = heldBackSignals;
+    for (const NotifySignal notifySignal : qAsConst(notifySignals)) {
+        Q_EMIT(this->*notifySignal)();
+    }
+}
+
+bool MpvDeclarativeObject::isPropertySignalHeldBack(
+    void (MpvDeclarativeObject::*notifySignal)()) const {
+    for (const PropertyBatch &batch : pendingPropertyBatches) {
+        if (batch.notifySignals.contains(notifySignal)) {
+            return true;
         }
     }
+    return false;
 }
 
 bool MpvDeclarativeObject::isLoaded() const {
-    return ((mediaStatus() == MediaStatus::Loaded) ||
-            (mediaStatus() == MediaStatus::Buffering) ||
-            (mediaStatus() == MediaStatus::Buffered));
+    const MediaStatus status = currentPlaybackSnapshot.mediaStatus;
+    return ((status == MediaStatus::Loaded) ||
+            (status == MediaStatus::Buffering) ||
+            (status == MediaStatus::Buffered));
 }
 
 bool MpvDeclarativeObject::isPlaying() const {
-    return playbackState() == PlaybackState::Playing;
+    return currentPlaybackSnapshot.playbackState == PlaybackState::Playing;
 }
 
 bool MpvDeclarativeObject::isPaused() const {
-    return playbackState() == PlaybackState::Paused;
+    return currentPlaybackSnapshot.playbackState == PlaybackState::Paused;
 }
 
 bool MpvDeclarativeObject::isStopped() const {
-    return playbackState() == PlaybackState::Stopped;
+    return currentPlaybackSnapshot.playbackState == PlaybackState::Stopped;
+}
+
+void MpvDeclarativeObject::updatePlaybackSnapshot() {
+    PlaybackSnapshot snapshot;
+    const bool stopped = mpvCachedProperty<bool>(MpvProperty::IdleActive);
+    const bool paused = mpvCachedProperty<bool>(MpvProperty::Pause);
+    snapshot.playbackState = stopped
+        ? PlaybackState::Stopped
+        : (paused ? PlaybackState::Paused : PlaybackState::Playing);
+    snapshot.mediaStatus = currentMediaStatus;
+    if (!stopped) {
+        snapshot.duration = qMax(
+            qRound64(mpvCachedProperty<double>(MpvProperty::Duration)),
+            qint64(0));
+        snapshot.seekable = mpvCachedProperty<bool>(MpvProperty::Seekable);
+        snapshot.videoSize =
+            QSize(qMax(static_cast<int>(
+                           mpvCachedProperty<qint64>(MpvProperty::DWidth)),
+                       0),
+                  qMax(static_cast<int>(
+                           mpvCachedProperty<qint64>(MpvProperty::DHeight)),
+                       0));
+        // Don't use videoRotate() here, it depends on the previous snapshot.
+        const int rotate =
+            mpvCachedProperty<QVariant>(MpvProperty::VideoOutParams)
+                .toMap()
+                .value(QLatin1String("rotate"))
+                .toInt();
+        if ((rotate == 90) || (rotate == 270)) {
+            snapshot.videoSize.transpose();
+        }
+    }
+    currentPlaybackSnapshot = snapshot;
 }
 
 void MpvDeclarativeObject::setMediaStatus(
@@ -223,10 +1811,17 @@ void MpvDeclarativeObject::setMediaStatus(
         return;
     }
     currentMediaStatus = mediaStatus;
+    currentPlaybackSnapshot.mediaStatus = mediaStatus;
     Q_EMIT mediaStatusChanged();
 }
 
-void MpvDeclarativeObject::videoReconfig() { Q_EMIT videoSizeChanged(); }
+void MpvDeclarativeObject::videoReconfig() {
+    Q_EMIT videoSizeChanged();
+    // Both are read from "video-out-params", which is only reliable after the
+    // video output has been reconfigured.
+    Q_EMIT videoRotateChanged();
+    Q_EMIT videoAspectChanged();
+}
 
 void MpvDeclarativeObject::audioReconfig() {}
 
@@ -240,19 +1835,31 @@ void MpvDeclarativeObject::playbackStateChangeEvent() {
     if (isStopped()) {
         Q_EMIT stopped();
     }
-    Q_EMIT playbackStateChanged();
 }
 
-bool MpvDeclarativeObject::mpvSendCommand(const QVariant &arguments) {
+bool MpvDeclarativeObject::mpvSendCommand(const QStringList &arguments) {
+    if (arguments.isEmpty()) {
+        return false;
+    }
+    return mpvSendCommandNode(QVariant(arguments));
+}
+
+bool MpvDeclarativeObject::mpvSendCommandNode(const QVariant &arguments) {
     if (arguments.isNull() || !arguments.isValid()) {
         return false;
     }
+    const MpvRequestRoute route = stageCommand(arguments);
+    if (route != MpvRequestRoute::Send) {
+        return (route == MpvRequestRoute::Staged);
+    }
     qDebug().noquote() << "Sending a command to mpv:" << arguments;
     int errorCode = 0;
     if (mpvCallType() == MpvCallType::Asynchronous) {
-        errorCode = mpv::qt::command_async(mpv, arguments, 0);
+        const qint64 id = mpvCommandAsync(arguments, QJSValue());
+        errorCode = (id < 0) ? int(id) : 0;
     } else {
-        errorCode = mpv::qt::get_error(mpv::qt::command(mpv, arguments));
+        errorCode = mpv::qt::get_error(
+            mpv::qt::command(mpv, arguments, &nodeArena));
     }
     if (errorCode < 0) {
         qWarning().noquote()
@@ -266,13 +1873,51 @@ bool MpvDeclarativeObject::mpvSetProperty(const QString &name,
     if (name.isEmpty() || value.isNull() || !value.isValid()) {
         return false;
     }
+    const MpvRequestRoute route = stageOption(name, value);
+    if (route != MpvRequestRoute::Send) {
+        return (route == MpvRequestRoute::Staged);
+    }
+    qDebug().noquote() << "Setting a property for mpv:" << name
+                       << "to:" << value;
+    int errorCode = 0;
+    if (mpvCallType() == MpvCallType::Asynchronous) {
+        const qint64 id = mpvSetPropertyAsync(name, value, QJSValue());
+        errorCode = (id < 0) ? int(id) : 0;
+    } else {
+        errorCode = mpv::qt::set_property(mpv, name, value, &nodeArena);
+        if (errorCode >= 0) {
+            changedOptions.insert(name);
+            invalidateCachedProperty(name);
+        }
+    }
+    if (errorCode < 0) {
+        qWarning().noquote() << "Failed to set a property for mpv:" << name;
+    }
+    return (errorCode >= 0);
+}
+
+template <typename T>
+bool MpvDeclarativeObject::mpvSetProperty(const QString &name,
+                                          const T &value) {
+    if (name.isEmpty()) {
+        return false;
+    }
+    const MpvRequestRoute route = stageOption(name, QVariant::fromValue(value));
+    if (route != MpvRequestRoute::Send) {
+        return (route == MpvRequestRoute::Staged);
+    }
     qDebug().noquote() << "Setting a property for mpv:" << name
                        << "to:" << value;
     int errorCode = 0;
     if (mpvCallType() == MpvCallType::Asynchronous) {
-        errorCode = mpv::qt::set_property_async(mpv, name, value, 0);
+        const qint64 id = mpvSetPropertyAsync<T>(name, value, QJSValue());
+        errorCode = (id < 0) ? int(id) : 0;
     } else {
-        errorCode = mpv::qt::get_error(mpv::qt::set_property(mpv, name, value));
+        errorCode = mpv::qt::set<T>(mpv, name.toUtf8().constData(), value);
+        if (errorCode >= 0) {
+            changedOptions.insert(name);
+            invalidateCachedProperty(name);
+        }
     }
     if (errorCode < 0) {
         qWarning().noquote() << "Failed to set a property for mpv:" << name;
@@ -280,49 +1925,615 @@ bool MpvDeclarativeObject::mpvSetProperty(const QString &name,
     return (errorCode >= 0);
 }
 
-QVariant MpvDeclarativeObject::mpvGetProperty(const QString &name,
-                                              bool *ok) const {
-    if (ok != nullptr) {
-        *ok = false;
+void MpvDeclarativeObject::invalidateCachedProperty(const QString &name) {
+    // Re-read the new value on next access instead of waiting for the change
+    // event, so that a getter right after a synchronous set is up to date.
+    const int index = mpvPropertyIndex(name);
+    if ((index >= 0) && propertyCache[index].valid) {
+        propertyCache[index].valid = false;
+        updatePlaybackSnapshot();
+    }
+}
+
+QVariant MpvDeclarativeObject::mpvGetProperty(const QString &name,
+                                              bool *ok) const {
+    if (ok != nullptr) {
+        *ok = false;
+    }
+    if (name.isEmpty()) {
+        return QVariant();
+    }
+    const QVariant result = mpv::qt::get_property(mpv, name);
+    if (result.isNull() || !result.isValid()) {
+        qWarning().noquote() << "Failed to query a property from mpv:" << name;
+    } else {
+        if (ok != nullptr) {
+            *ok = true;
+        }
+        /*if ((name != QLatin1String("time-pos")) &&
+            (name != QLatin1String("duration"))) {
+            qDebug().noquote() << "Querying a property from mpv:"
+                               << name << "result:" << result;
+        }*/
+    }
+    return result;
+}
+
+bool MpvDeclarativeObject::mpvObserveProperty(const QString &name,
+                                              mpv_format format, quint64 id) {
+    if (name.isEmpty()) {
+        return false;
+    }
+    qDebug().noquote() << "Observing a property from mpv:" << name;
+    const int errorCode =
+        mpv_observe_property(mpv, id, name.toUtf8().constData(), format);
+    if (errorCode < 0) {
+        qWarning().noquote()
+            << "Failed to observe a property from mpv:" << name;
+    }
+    return (errorCode >= 0);
+}
+
+quint64 MpvDeclarativeObject::nextAsyncRequestId() {
+    // Unique across players: a pooled handle may still deliver replies to
+    // requests of its previous owner.
+    static QAtomicInteger<quint64> lastAsyncRequestId = 0;
+    return asyncRequestIdBase + lastAsyncRequestId.fetchAndAddRelaxed(1) + 1;
+}
+
+int MpvDeclarativeObject::mpvGetPropertyAsync(
+    const QString &name, const PendingPropertyGet &request) {
+    if (name.isEmpty()) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    if (mpvInitState == MpvInitState::Failed) {
+        return MPV_ERROR_UNINITIALIZED;
+    }
+    qDebug().noquote() << "Getting a property from mpv asynchronously:"
+                       << name;
+    const quint64 id = nextAsyncRequestId();
+    const int errorCode = mpv_get_property_async(
+        mpv, id, name.toUtf8().constData(), MPV_FORMAT_NODE);
+    if (errorCode < 0) {
+        qWarning().noquote()
+            << "Failed to get a property from mpv asynchronously:" << name;
+        return errorCode;
+    }
+    pendingPropertyGets.insert(id, request);
+    return errorCode;
+}
+
+void MpvDeclarativeObject::finishPropertyGet(PendingPropertyGet &request,
+                                             const QVariant &value) {
+    const int errorCode = mpv::qt::get_error(value);
+    callJsCallback(request.callback, (errorCode < 0) ? QVariant() : value,
+                   errorCode, request.name);
+    if (request.promise.isStarted()) {
+        request.promise.reportResult(value);
+        request.promise.reportFinished();
+    }
+}
+
+void MpvDeclarativeObject::callJsCallback(const QJSValue &callback,
+                                          const QVariant &result,
+                                          int errorCode, const QString &name) {
+    if (!callback.isCallable()) {
+        return;
+    }
+    QJSEngine *engine = qjsEngine(this);
+    const QJSValue returned = callback.call(
+        {(engine != nullptr) ? engine->toScriptValue(result) : QJSValue(),
+         QJSValue(errorCode)});
+    if (returned.isError()) {
+        qWarning().noquote() << "Error in the callback of an asynchronous"
+                             << "request for" << name << ':'
+                             << returned.toString();
+    }
+}
+
+quint64 MpvDeclarativeObject::trackAsyncRequest(const QString &name,
+                                                const QJSValue &callback) {
+    if (pendingAsyncRequests.size() >= maxPendingAsyncRequests) {
+        qWarning().noquote()
+            << "Too many asynchronous requests in flight, dropping:" << name;
+        return 0;
+    }
+    const quint64 id = nextAsyncRequestId();
+    PendingAsyncRequest request;
+    request.name = name;
+    request.callback = callback;
+    pendingAsyncRequests.insert(id, request);
+    return id;
+}
+
+template <typename Args>
+qint64 MpvDeclarativeObject::mpvCommandAsync(const Args &arguments,
+                                             const QJSValue &callback) {
+    const quint64 id = trackAsyncRequest(commandName(arguments), callback);
+    if (id == 0) {
+        return MPV_ERROR_EVENT_QUEUE_FULL;
+    }
+    const int errorCode =
+        mpv::qt::command_async(mpv, arguments, id, &nodeArena);
+    if (errorCode < 0) {
+        pendingAsyncRequests.remove(id);
+        return errorCode;
+    }
+    return qint64(id);
+}
+
+template <typename T>
+qint64 MpvDeclarativeObject::mpvSetPropertyAsync(const QString &name,
+                                                 const T &value,
+                                                 const QJSValue &callback) {
+    const quint64 id = trackAsyncRequest(name, callback);
+    if (id == 0) {
+        return MPV_ERROR_EVENT_QUEUE_FULL;
+    }
+    changedOptions.insert(name);
+    int errorCode = 0;
+    if constexpr (std::is_same<T, QVariant>::value) {
+        errorCode =
+            mpv::qt::set_property_async(mpv, name, value, id, &nodeArena);
+    } else {
+        errorCode = mpv::qt::set_async<T>(mpv, name.toUtf8().constData(),
+                                          value, id);
+    }
+    if (errorCode < 0) {
+        pendingAsyncRequests.remove(id);
+        return errorCode;
+    }
+    return qint64(id);
+}
+
+void MpvDeclarativeObject::processMpvAsyncReply(mpv_event *event) {
+    const auto it = pendingAsyncRequests.find(event->reply_userdata);
+    if (it == pendingAsyncRequests.end()) {
+        return;
+    }
+    // Take it out first, the callback may send new requests.
+    const PendingAsyncRequest request = it.value();
+    pendingAsyncRequests.erase(it);
+    // Once the last one of a batch is in, its held back notify signals go out
+    // at the end of this event batch.
+    for (int i = pendingPropertyBatches.size() - 1; i >= 0; --i) {
+        PropertyBatch &batch = pendingPropertyBatches[i];
+        batch.pendingIds.remove(event->reply_userdata);
+        if (batch.pendingIds.isEmpty()) {
+            pendingPropertyBatches.remove(i);
+        }
+    }
+    QVariant result = QVariant();
+    if ((event->event_id == MPV_EVENT_COMMAND_REPLY) && (event->error >= 0)) {
+        result = mpv::qt::node_to_variant(
+            &static_cast<mpv_event_command *>(event->data)->result);
+    }
+    if (event->error < 0) {
+        qWarning().noquote()
+            << "Asynchronous request failed for" << request.name << ':'
+            << QString::fromUtf8(mpv_error_string(event->error));
+    }
+    callJsCallback(request.callback, result, event->error, request.name);
+    Q_EMIT commandFinished(qint64(event->reply_userdata), event->error,
+                           result);
+    for (int i = 0; i < coalescedSlots.size(); ++i) {
+        if (coalescedSlots.at(i).inFlightId != event->reply_userdata) {
+            continue;
+        }
+        const auto kind = static_cast<CoalescedRequest>(i);
+        // The reply of a seek command only means it has been queued, it's
+        // done on MPV_EVENT_PLAYBACK_RESTART.
+        if ((kind != CoalescedRequest::Seek) || (event->error < 0)) {
+            releaseCoalescedRequest(kind);
+        }
+    }
+}
+
+bool MpvDeclarativeObject::mpvSendCoalesced(CoalescedRequest kind,
+                                            const QStringList &arguments) {
+    const MpvRequestRoute route = stageCommand(arguments);
+    if (route != MpvRequestRoute::Send) {
+        return (route == MpvRequestRoute::Staged);
+    }
+    CoalescedSlot &slot = coalescedSlots[static_cast<int>(kind)];
+    if (slot.inFlightId != 0) {
+        slot.queued = arguments;
+        return true;
+    }
+    qDebug().noquote() << "Sending a command to mpv asynchronously:"
+                       << arguments;
+    const qint64 id = mpvCommandAsync(arguments, QJSValue());
+    if (id < 0) {
+        qWarning().noquote()
+            << "Failed to execute a command for mpv:" << arguments;
+        return false;
+    }
+    slot.inFlightId = quint64(id);
+    if (kind == CoalescedRequest::Seek) {
+        seekTimer.start();
+    } else {
+        changedOptions.insert(arguments.at(1));
+    }
+    return true;
+}
+
+void MpvDeclarativeObject::releaseCoalescedRequest(CoalescedRequest kind) {
+    CoalescedSlot &slot = coalescedSlots[static_cast<int>(kind)];
+    slot.inFlightId = 0;
+    if (slot.queued.isEmpty()) {
+        if (kind == CoalescedRequest::Seek) {
+            pendingSeekPosition = -1;
+        }
+        return;
+    }
+    const QStringList arguments = slot.queued;
+    slot.queued.clear();
+    mpvSendCoalesced(kind, arguments);
+}
+
+bool MpvDeclarativeObject::isCoalescedRequestPending(
+    CoalescedRequest kind) const {
+    return (coalescedSlots.at(static_cast<int>(kind)).inFlightId != 0);
+}
+
+void MpvDeclarativeObject::processMpvGetPropertyReply(mpv_event *event) {
+    const auto it = pendingPropertyGets.find(event->reply_userdata);
+    if (it == pendingPropertyGets.end()) {
+        return;
+    }
+    // Take it out first, the callback may send new requests.
+    PendingPropertyGet request = it.value();
+    pendingPropertyGets.erase(it);
+    finishPropertyGet(
+        request,
+        (event->error < 0)
+            ? QVariant::fromValue(mpv::qt::ErrorReturn(event->error))
+            : mpv::qt::property_to_variant(
+                  static_cast<mpv_event_property *>(event->data)));
+}
+
+void MpvDeclarativeObject::setPropertyObserved(int index, bool observed) {
+    CachedProperty &cached = propertyCache[index];
+    if (cached.observed == observed) {
+        return;
+    }
+    const MpvPropertyInfo &info = mpvProperties[index];
+    if (observed) {
+        cached.observed = mpvObserveProperty(QLatin1String(info.name),
+                                             info.format, index + 1);
+        return;
+    }
+    qDebug().noquote() << "Unobserving a property from mpv:" << info.name;
+    mpv_unobserve_property(mpv, index + 1);
+    cached.observed = false;
+    cached.valid = false;
+}
+
+void MpvDeclarativeObject::connectNotify(const QMetaMethod &signal) {
+    QQuickFramebufferObject::connectNotify(signal);
+    // Several properties can share one notify signal (e.g. dwidth and
+    // dheight), and each property is observed at most once however many
+    // receivers there are.
+    for (int i = 0; i < mpvPropertyCount; ++i) {
+        const MpvPropertyInfo &info = mpvProperties[i];
+        if ((info.notifySignal != nullptr) && !propertyCache.at(i).observed &&
+            (signal == QMetaMethod::fromSignal(info.notifySignal))) {
+            setPropertyObserved(i, true);
+        }
+    }
+}
+
+void MpvDeclarativeObject::disconnectNotify(const QMetaMethod &signal) {
+    QQuickFramebufferObject::disconnectNotify(signal);
+    // signal is invalid if everything was disconnected at once, so check
+    // every observed property then.
+    for (int i = 0; i < mpvPropertyCount; ++i) {
+        if ((mpvProperties[i].notifySignal == nullptr) ||
+            !propertyCache.at(i).observed) {
+            continue;
+        }
+        const QMetaMethod notifySignal =
+            QMetaMethod::fromSignal(mpvProperties[i].notifySignal);
+        if ((signal.isValid() && (signal != notifySignal)) ||
+            isSignalConnected(notifySignal)) {
+            continue;
+        }
+        if (std::find(std::cbegin(alwaysObservedProperties),
+                      std::cend(alwaysObservedProperties),
+                      static_cast<MpvProperty>(i)) ==
+            std::cend(alwaysObservedProperties)) {
+            setPropertyObserved(i, false);
+        }
+    }
+}
+
+QQuickFramebufferObject::Renderer *
+MpvDeclarativeObject::createRenderer() const {
+    window()->setPersistentOpenGLContext(true);
+    window()->setPersistentSceneGraph(true);
+    return new MpvRenderer(const_cast<MpvDeclarativeObject *>(this));
+}
+
+void MpvDeclarativeObject::geometryChanged(const QRectF &newGeometry,
+                                           const QRectF &oldGeometry) {
+    QQuickFramebufferObject::geometryChanged(newGeometry, oldGeometry);
+    if (newGeometry.size() == oldGeometry.size()) {
+        return;
+    }
+    // Nothing to reuse before the first frame.
+    if (currentFramebufferSize.isEmpty()) {
+        settleRenderSize();
+        return;
+    }
+    // Keep rendering at the old size during animations and interactive
+    // resizes, the texture is scaled in the meantime.
+    resizeTimer.start();
+}
+
+void MpvDeclarativeObject::settleRenderSize() {
+    const qreal ratio = (window() != nullptr)
+        ? window()->effectiveDevicePixelRatio()
+        : 1.0;
+    const QSize size = (QSizeF(width(), height()) * ratio).toSize();
+    // Texture consumers sample the whole FBO, it can't be larger than the
+    // video then.
+    const bool exact = (textureProviderRequested.loadAcquire() != 0);
+    if (size.isEmpty() ||
+        ((size == renderSize) &&
+         (!exact || (size == currentFramebufferSize)))) {
+        return;
+    }
+    renderSize = size;
+    if (currentFramebufferSize.isEmpty()) {
+        update();
+        return;
+    }
+    // Reallocate if the FBO is too small, or much larger than needed.
+    const QSize bucket = framebufferBucket(size);
+    if (exact
+            ? (currentFramebufferSize != size)
+            : ((currentFramebufferSize.width() < size.width()) ||
+               (currentFramebufferSize.height() < size.height()) ||
+               ((bucket.width() * bucket.height() * 2) <
+                (currentFramebufferSize.width() *
+                 currentFramebufferSize.height())))) {
+        invalidateFramebufferObject();
+    }
+    update();
+}
+
+QSize MpvDeclarativeObject::framebufferSize() const {
+    return currentFramebufferSize;
+}
+
+bool MpvDeclarativeObject::isTextureProvider() const {
+    return true;
+}
+
+// Called on the render thread, usually while the GUI thread is blocked in
+// the consumer's updatePaintNode().
+QSGTextureProvider *MpvDeclarativeObject::textureProvider() const {
+    // layer.enabled makes the item itself the provider.
+    if (QQuickItem::isTextureProvider()) {
+        return QQuickItem::textureProvider();
+    }
+    auto *self = const_cast<MpvDeclarativeObject *>(this);
+    // From now on the FBO has to hold every frame, at the exact item size.
+    if (self->textureProviderRequested.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(
+            self, [self]() { self->settleRenderSize(); },
+            Qt::QueuedConnection);
+    }
+#ifdef MPV_RENDER_API_TYPE_SW
+    // Only what updatePaintNode() stored on this thread is read here, the
+    // backend is decided there. Until then there's nothing to provide.
+    if (resolvedRenderBackend == RenderBackend::Automatic) {
+        return nullptr;
     }
-    if (name.isEmpty()) {
-        return QVariant();
+    if (resolvedRenderBackend == RenderBackend::Software) {
+        // The node owns it.
+        return softwareTextureProvider;
     }
-    const QVariant result = mpv::qt::get_property(mpv, name);
-    if (result.isNull() || !result.isValid()) {
-        qWarning().noquote() << "Failed to query a property from mpv:" << name;
-    } else {
-        if (ok != nullptr) {
-            *ok = true;
+#endif
+    return QQuickFramebufferObject::textureProvider();
+}
+
+MpvDeclarativeObject::RenderBackend
+MpvDeclarativeObject::resolveRenderBackend() const {
+#ifdef MPV_RENDER_API_TYPE_SW
+    if (currentRenderBackend != RenderBackend::Automatic) {
+        return currentRenderBackend;
+    }
+    const QSGRendererInterface *rif = window()->rendererInterface();
+    if ((rif == nullptr) ||
+        (rif->graphicsApi() != QSGRendererInterface::OpenGL)) {
+        return RenderBackend::Software;
+    }
+    // mpv's shaders are slower than its software renderer when OpenGL is
+    // emulated on the CPU.
+    const QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (context == nullptr) {
+        return RenderBackend::OpenGL;
+    }
+    const auto *renderer = reinterpret_cast<const char *>(
+        context->functions()->glGetString(GL_RENDERER));
+    const QString name = QString::fromLatin1(renderer).toLower();
+    for (const char *software :
+         {"llvmpipe", "softpipe", "swiftshader", "software rasterizer"}) {
+        if (name.contains(QLatin1String(software))) {
+            return RenderBackend::Software;
         }
-        /*if ((name != QLatin1String("time-pos")) &&
-            (name != QLatin1String("duration"))) {
-            qDebug().noquote() << "Querying a property from mpv:"
-                               << name << "result:" << result;
-        }*/
     }
-    return result;
+#endif
+    return RenderBackend::OpenGL;
 }
 
-bool MpvDeclarativeObject::mpvObserveProperty(const QString &name) {
-    if (name.isEmpty()) {
+bool MpvDeclarativeObject::canRenderDirectly() const {
+    if (!currentDirectRendering || (window() == nullptr) || clip()) {
         return false;
     }
-    qDebug().noquote() << "Observing a property from mpv:" << name;
-    const int errorCode = mpv_observe_property(
-        mpv, 0, name.toUtf8().constData(), MPV_FORMAT_NONE);
-    if (errorCode < 0) {
-        qWarning().noquote()
-            << "Failed to observe a property from mpv:" << name;
+    // Other items sample the FBO.
+    if (textureProviderRequested.loadAcquire() != 0) {
+        return false;
     }
-    return (errorCode >= 0);
+    const QSGRendererInterface *rif = window()->rendererInterface();
+    if ((rif == nullptr) ||
+        (rif->graphicsApi() != QSGRendererInterface::OpenGL)) {
+        return false;
+    }
+    for (const QQuickItem *item = this; item != nullptr;
+         item = item->parentItem()) {
+        // layer.enabled makes an item a texture provider, it's rendered into
+        // a texture then. This item always claims to be one.
+        const bool textureProvider = (item == this)
+            ? QQuickItem::isTextureProvider()
+            : item->isTextureProvider();
+        if (!item->isVisible() || (item->opacity() < 1.0) || textureProvider) {
+            return false;
+        }
+    }
+    // Opaque and untransformed, covering the whole window. The video is drawn
+    // before the scene, whatever is drawn below the item would cover it.
+    return (mapToScene(QPointF(0.0, 0.0)) == QPointF(0.0, 0.0)) &&
+        (mapToScene(QPointF(width(), height())) ==
+         QPointF(window()->width(), window()->height())) &&
+        !drawsBelow(this);
 }
 
-QQuickFramebufferObject::Renderer *
-MpvDeclarativeObject::createRenderer() const {
-    window()->setPersistentOpenGLContext(true);
-    window()->setPersistentSceneGraph(true);
-    return new MpvRenderer(const_cast<MpvDeclarativeObject *>(this));
+void MpvDeclarativeObject::checkRenderingPath() {
+    // Ancestors don't update this item when they change, e.g. a parent
+    // fading out while playback is paused.
+    if (currentDirectRendering && (canRenderDirectly() != renderingDirectly)) {
+        update();
+    }
+}
+
+void MpvDeclarativeObject::trackRenderingPathChanges() {
+    for (const QMetaObject::Connection &connection :
+         qAsConst(renderingPathConnections)) {
+        disconnect(connection);
+    }
+    renderingPathConnections.clear();
+    if (!currentDirectRendering || (window() == nullptr)) {
+        return;
+    }
+    // Geometry, stacking and visibility, children for what is drawn below.
+    static constexpr void (QQuickItem::*changeSignals[])() = {
+        &QQuickItem::visibleChanged, &QQuickItem::opacityChanged,
+        &QQuickItem::xChanged,       &QQuickItem::yChanged,
+        &QQuickItem::widthChanged,   &QQuickItem::heightChanged,
+        &QQuickItem::zChanged,       &QQuickItem::scaleChanged,
+        &QQuickItem::rotationChanged, &QQuickItem::childrenChanged,
+    };
+    for (QQuickItem *item = this; item != nullptr; item = item->parentItem()) {
+        for (const auto changeSignal : changeSignals) {
+            renderingPathConnections.append(connect(
+                item, changeSignal, this,
+                &MpvDeclarativeObject::checkRenderingPath));
+        }
+        renderingPathConnections.append(
+            connect(item, &QQuickItem::clipChanged, this,
+                    &MpvDeclarativeObject::checkRenderingPath));
+        // The ancestors are different from there on.
+        renderingPathConnections.append(
+            connect(item, &QQuickItem::parentChanged, this,
+                    &MpvDeclarativeObject::trackRenderingPathChanges));
+    }
+    checkRenderingPath();
+}
+
+void MpvDeclarativeObject::restoreWindowClearing() {
+    if (clearDisabledWindow != nullptr) {
+        clearDisabledWindow->setClearBeforeRendering(true);
+        clearDisabledWindow.clear();
+    }
+}
+
+QSGNode *MpvDeclarativeObject::updatePaintNode(QSGNode *node,
+                                               UpdatePaintNodeData *data) {
+    auto *root = static_cast<MpvRootNode *>(node);
+    if (root == nullptr) {
+        root = new MpvRootNode(window());
+    }
+    // Created by the render thread outside of synchronization, picked up on
+    // the next frame.
+    root->setRenderContext(renderContext);
+    // mpv allows a single render context per handle, so the backend can't
+    // change once it has been created.
+    if (resolvedRenderBackend == RenderBackend::Automatic) {
+        resolvedRenderBackend = resolveRenderBackend();
+    }
+#ifdef MPV_RENDER_API_TYPE_SW
+    // Its render context was never created, see renderContextFailed().
+    if (softwareBackendFailed &&
+        (resolvedRenderBackend == RenderBackend::Software)) {
+        resolvedRenderBackend = RenderBackend::OpenGL;
+        if (root->softwareNode != nullptr) {
+            root->removeChildNode(root->softwareNode);
+            delete root->softwareNode;
+            root->softwareNode = nullptr;
+        }
+        renderContextError.storeRelease(0);
+    }
+    if (resolvedRenderBackend == RenderBackend::Software) {
+        auto *softwareNode = static_cast<MpvSoftwareNode *>(root->softwareNode);
+        if (softwareNode == nullptr) {
+            softwareNode = new MpvSoftwareNode(this);
+            softwareTextureProvider = softwareNode->provider();
+            root->softwareNode = softwareNode;
+            root->appendChildNode(softwareNode);
+        }
+        const qreal ratio = window()->effectiveDevicePixelRatio();
+        softwareNode->synchronize(
+            QRectF(0.0, 0.0, width(), height()),
+            renderSize.isEmpty()
+                ? (QSizeF(width(), height()) * ratio).toSize()
+                : renderSize);
+        softwareNode->markDirty(QSGNode::DirtyMaterial);
+        return root;
+    }
+#endif
+    renderingDirectly = canRenderDirectly();
+    if (renderingDirectly) {
+        if ((root->framebufferNode != nullptr) &&
+            (root->framebufferNode->parent() == root)) {
+            root->removeChildNode(root->framebufferNode);
+        }
+        // The context is current during synchronization. Create the render
+        // context now, beforeRendering() has no access to the item.
+        initializeRenderContext();
+        root->setRenderContext(renderContext);
+        root->setDirectTargetSize(window()->size() *
+                                  window()->effectiveDevicePixelRatio());
+        // mpv draws the whole window, clearing it first would be wasted.
+        if (window()->clearBeforeRendering()) {
+            window()->setClearBeforeRendering(false);
+            clearDisabledWindow = window();
+        }
+        framebufferStale = true;
+        return root;
+    }
+    root->setDirectTargetSize(QSize());
+    restoreWindowClearing();
+    root->framebufferNode =
+        QQuickFramebufferObject::updatePaintNode(root->framebufferNode, data);
+    if (root->framebufferNode == nullptr) {
+        return root;
+    }
+    if (root->framebufferNode->parent() == nullptr) {
+        root->appendChildNode(root->framebufferNode);
+    }
+    // Show the rendered part of the FBO only, scaled to the item while it's
+    // being resized.
+    auto *textureNode =
+        dynamic_cast<QSGSimpleTextureNode *>(root->framebufferNode);
+    if ((textureNode != nullptr) && !currentFramebufferSize.isEmpty()) {
+        const QSize size = renderSize.isEmpty()
+            ? currentFramebufferSize
+            : renderSize.boundedTo(currentFramebufferSize);
+        textureNode->setSourceRect(QRectF(QPointF(0.0, 0.0), size));
+    }
+    return root;
 }
 
 QUrl MpvDeclarativeObject::source() const {
@@ -330,30 +2541,18 @@ QUrl MpvDeclarativeObject::source() const {
 }
 
 QString MpvDeclarativeObject::fileName() const {
-    return isStopped() ? QString()
-                       : mpvGetProperty(QLatin1String("filename")).toString();
+    return isStopped()
+        ? QString()
+        : mpvCachedProperty<QString>(MpvProperty::FileName);
 }
 
 QSize MpvDeclarativeObject::videoSize() const {
-    if (isStopped()) {
-        return QSize();
-    }
-    QSize size(
-        qMax(mpvGetProperty(QLatin1String("video-out-params/dw")).toInt(), 0),
-        qMax(mpvGetProperty(QLatin1String("video-out-params/dh")).toInt(), 0));
-    const int rotate = videoRotate();
-    if ((rotate == 90) || (rotate == 270)) {
-        size.transpose();
-    }
-    return size;
+    return currentPlaybackSnapshot.videoSize;
 }
 
 MpvDeclarativeObject::PlaybackState
 MpvDeclarativeObject::playbackState() const {
-    const bool stopped = mpvGetProperty(QLatin1String("idle-active")).toBool();
-    const bool paused = mpvGetProperty(QLatin1String("pause")).toBool();
-    return stopped ? PlaybackState::Stopped
-                   : (paused ? PlaybackState::Paused : PlaybackState::Playing);
+    return currentPlaybackSnapshot.playbackState;
 }
 
 MpvDeclarativeObject::MediaStatus MpvDeclarativeObject::mediaStatus() const {
@@ -361,7 +2560,8 @@ MpvDeclarativeObject::MediaStatus MpvDeclarativeObject::mediaStatus() const {
 }
 
 MpvDeclarativeObject::LogLevel MpvDeclarativeObject::logLevel() const {
-    const QString level = mpvGetProperty(QLatin1String("msg-level")).toString();
+    const QString level =
+        mpvCachedProperty<QString>(MpvProperty::MsgLevel);
     if (level.isEmpty() || (level == QLatin1String("no")) ||
         (level == QLatin1String("off"))) {
         return LogLevel::Off;
@@ -393,54 +2593,52 @@ MpvDeclarativeObject::LogLevel MpvDeclarativeObject::logLevel() const {
 }
 
 qint64 MpvDeclarativeObject::duration() const {
-    return isStopped()
-        ? 0
-        : qMax(mpvGetProperty(QLatin1String("duration")).toLongLong(),
-               qint64(0));
+    return currentPlaybackSnapshot.duration;
 }
 
 qint64 MpvDeclarativeObject::position() const {
-    return isStopped()
-        ? 0
-        : qMin(qMax(mpvGetProperty(QLatin1String("time-pos")).toLongLong(),
-                    qint64(0)),
-               duration());
+    if (isStopped()) {
+        return 0;
+    }
+    return qMin(qMax(qRound64(mpvCachedProperty<double>(MpvProperty::TimePos)),
+                     qint64(0)),
+                duration());
 }
 
 int MpvDeclarativeObject::volume() const {
-    return qMin(qMax(mpvGetProperty(QLatin1String("volume")).toInt(), 0), 100);
+    return qMin(qMax(qRound(mpvCachedProperty<double>(MpvProperty::Volume)), 0),
+                100);
 }
 
 bool MpvDeclarativeObject::mute() const {
-    return mpvGetProperty(QLatin1String("mute")).toBool();
+    return mpvCachedProperty<bool>(MpvProperty::Mute);
 }
 
 bool MpvDeclarativeObject::seekable() const {
-    return isStopped() ? false
-                       : mpvGetProperty(QLatin1String("seekable")).toBool();
+    return currentPlaybackSnapshot.seekable;
 }
 
 QString MpvDeclarativeObject::mediaTitle() const {
     return isStopped()
         ? QString()
-        : mpvGetProperty(QLatin1String("media-title")).toString();
+        : mpvCachedProperty<QString>(MpvProperty::MediaTitle);
 }
 
 QString MpvDeclarativeObject::hwdec() const {
     // Querying "hwdec" itself will return empty string.
-    return mpvGetProperty(QLatin1String("hwdec-current")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::HwdecCurrent);
 }
 
 QString MpvDeclarativeObject::mpvVersion() const {
-    return mpvGetProperty(QLatin1String("mpv-version")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::MpvVersion);
 }
 
 QString MpvDeclarativeObject::mpvConfiguration() const {
-    return mpvGetProperty(QLatin1String("mpv-configuration")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::MpvConfiguration);
 }
 
 QString MpvDeclarativeObject::ffmpegVersion() const {
-    return mpvGetProperty(QLatin1String("ffmpeg-version")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::FfmpegVersion);
 }
 
 QString MpvDeclarativeObject::qtVersion() const {
@@ -450,58 +2648,67 @@ QString MpvDeclarativeObject::qtVersion() const {
 }
 
 int MpvDeclarativeObject::vid() const {
-    return isStopped() ? 0 : mpvGetProperty(QLatin1String("vid")).toInt();
+    // "vid", "aid" and "sid" can also be "no" or "auto", so they are
+    // observed as MPV_FORMAT_NODE.
+    return isStopped()
+        ? 0
+        : mpvCachedProperty<QVariant>(MpvProperty::Vid).toInt();
 }
 
 int MpvDeclarativeObject::aid() const {
-    return isStopped() ? 0 : mpvGetProperty(QLatin1String("aid")).toInt();
+    return isStopped()
+        ? 0
+        : mpvCachedProperty<QVariant>(MpvProperty::Aid).toInt();
 }
 
 int MpvDeclarativeObject::sid() const {
-    return isStopped() ? 0 : mpvGetProperty(QLatin1String("sid")).toInt();
+    return isStopped()
+        ? 0
+        : mpvCachedProperty<QVariant>(MpvProperty::Sid).toInt();
 }
 
 int MpvDeclarativeObject::videoRotate() const {
-    return isStopped()
-        ? 0
-        : qMin((qMax(mpvGetProperty(QLatin1String("video-out-params/rotate"))
-                         .toInt(),
-                     0) +
-                360) %
-                   360,
-               359);
+    if (isStopped()) {
+        return 0;
+    }
+    const QVariantMap params =
+        mpvCachedProperty<QVariant>(MpvProperty::VideoOutParams).toMap();
+    return qMin((qMax(params.value(QLatin1String("rotate")).toInt(), 0) + 360) %
+                    360,
+                359);
 }
 
 qreal MpvDeclarativeObject::videoAspect() const {
-    return isStopped()
-        ? 1.7777
-        : qMax(
-              mpvGetProperty(QLatin1String("video-out-params/aspect")).toReal(),
-              0.0);
+    if (isStopped()) {
+        return 1.7777;
+    }
+    const QVariantMap params =
+        mpvCachedProperty<QVariant>(MpvProperty::VideoOutParams).toMap();
+    return qMax(params.value(QLatin1String("aspect")).toReal(), 0.0);
 }
 
 qreal MpvDeclarativeObject::speed() const {
-    return qMax(mpvGetProperty(QLatin1String("speed")).toReal(), 0.0);
+    return qMax(mpvCachedProperty<double>(MpvProperty::Speed), 0.0);
 }
 
 bool MpvDeclarativeObject::deinterlace() const {
-    return mpvGetProperty(QLatin1String("deinterlace")).toBool();
+    return mpvCachedProperty<bool>(MpvProperty::Deinterlace);
 }
 
 bool MpvDeclarativeObject::audioExclusive() const {
-    return mpvGetProperty(QLatin1String("audio-exclusive")).toBool();
+    return mpvCachedProperty<bool>(MpvProperty::AudioExclusive);
 }
 
 QString MpvDeclarativeObject::audioFileAuto() const {
-    return mpvGetProperty(QLatin1String("audio-file-auto")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::AudioFileAuto);
 }
 
 QString MpvDeclarativeObject::subAuto() const {
-    return mpvGetProperty(QLatin1String("sub-auto")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::SubAuto);
 }
 
 QString MpvDeclarativeObject::subCodepage() const {
-    QString codePage = mpvGetProperty(QLatin1String("sub-codepage")).toString();
+    QString codePage = mpvCachedProperty<QString>(MpvProperty::SubCodepage);
     if (codePage.startsWith(QLatin1Char('+'))) {
         codePage.remove(0, 1);
     }
@@ -509,95 +2716,99 @@ QString MpvDeclarativeObject::subCodepage() const {
 }
 
 QString MpvDeclarativeObject::vo() const {
-    return mpvGetProperty(QLatin1String("vo")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::Vo);
 }
 
 QString MpvDeclarativeObject::ao() const {
-    return mpvGetProperty(QLatin1String("ao")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::Ao);
 }
 
 QString MpvDeclarativeObject::screenshotFormat() const {
-    return mpvGetProperty(QLatin1String("screenshot-format")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::ScreenshotFormat);
 }
 
 bool MpvDeclarativeObject::screenshotTagColorspace() const {
-    return mpvGetProperty(QLatin1String("screenshot-tag-colorspace")).toBool();
+    return mpvCachedProperty<bool>(MpvProperty::ScreenshotTagColorspace);
 }
 
 int MpvDeclarativeObject::screenshotPngCompression() const {
-    return qMin(
-        qMax(
-            mpvGetProperty(QLatin1String("screenshot-png-compression")).toInt(),
-            0),
-        9);
+    return qMin(qMax(static_cast<int>(mpvCachedProperty<qint64>(
+                         MpvProperty::ScreenshotPngCompression)),
+                     0),
+                9);
 }
 
 int MpvDeclarativeObject::screenshotJpegQuality() const {
-    return qMin(
-        qMax(mpvGetProperty(QLatin1String("screenshot-jpeg-quality")).toInt(),
-             0),
-        100);
+    return qMin(qMax(static_cast<int>(mpvCachedProperty<qint64>(
+                         MpvProperty::ScreenshotJpegQuality)),
+                     0),
+                100);
 }
 
 QString MpvDeclarativeObject::screenshotTemplate() const {
-    return mpvGetProperty(QLatin1String("screenshot-template")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::ScreenshotTemplate);
 }
 
 QString MpvDeclarativeObject::screenshotDirectory() const {
-    return mpvGetProperty(QLatin1String("screenshot-directory")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::ScreenshotDirectory);
 }
 
 QString MpvDeclarativeObject::profile() const {
-    return mpvGetProperty(QLatin1String("profile")).toString();
+    return mpvCachedProperty<QString>(MpvProperty::Profile);
 }
 
 bool MpvDeclarativeObject::hrSeek() const {
-    return mpvGetProperty(QLatin1String("hr-seek")).toBool();
+    // hr-seek is a choice (no/absolute/yes/default), not a flag.
+    return mpvCachedProperty<QString>(MpvProperty::HrSeek) ==
+        QLatin1String("yes");
+}
+
+QString MpvDeclarativeObject::videoSync() const {
+    return mpvCachedProperty<QString>(MpvProperty::VideoSync);
 }
 
 bool MpvDeclarativeObject::ytdl() const {
-    return mpvGetProperty(QLatin1String("ytdl")).toBool();
+    return mpvCachedProperty<bool>(MpvProperty::Ytdl);
 }
 
 bool MpvDeclarativeObject::loadScripts() const {
-    return mpvGetProperty(QLatin1String("load-scripts")).toBool();
+    return mpvCachedProperty<bool>(MpvProperty::LoadScripts);
 }
 
 QString MpvDeclarativeObject::path() const {
     return isStopped() ? QString()
-                       : mpvGetProperty(QLatin1String("path")).toString();
+                       : mpvCachedProperty<QString>(MpvProperty::Path);
 }
 
 QString MpvDeclarativeObject::fileFormat() const {
     return isStopped()
         ? QString()
-        : mpvGetProperty(QLatin1String("file-format")).toString();
+        : mpvCachedProperty<QString>(MpvProperty::FileFormat);
 }
 
 qint64 MpvDeclarativeObject::fileSize() const {
     return isStopped()
         ? 0
-        : qMax(mpvGetProperty(QLatin1String("file-size")).toLongLong(),
-               qint64(0));
+        : qMax(mpvCachedProperty<qint64>(MpvProperty::FileSize), qint64(0));
 }
 
 qreal MpvDeclarativeObject::videoBitrate() const {
     return isStopped()
         ? 0.0
-        : qMax(mpvGetProperty(QLatin1String("video-bitrate")).toReal(), 0.0);
+        : qMax(mpvCachedProperty<double>(MpvProperty::VideoBitrate), 0.0);
 }
 
 qreal MpvDeclarativeObject::audioBitrate() const {
     return isStopped()
         ? 0.0
-        : qMax(mpvGetProperty(QLatin1String("audio-bitrate")).toReal(), 0.0);
+        : qMax(mpvCachedProperty<double>(MpvProperty::AudioBitrate), 0.0);
 }
 
 MpvDeclarativeObject::AudioDevices
 MpvDeclarativeObject::audioDeviceList() const {
     AudioDevices audioDevices;
     QVariantList deviceList =
-        mpvGetProperty(QLatin1String("audio-device-list")).toList();
+        mpvCachedProperty<QVariant>(MpvProperty::AudioDeviceList).toList();
     for (const auto &device : deviceList) {
         const auto &deviceInfo = device.toMap();
         SingleTrackInfo singleTrackInfo;
@@ -611,7 +2822,7 @@ MpvDeclarativeObject::audioDeviceList() const {
 QString MpvDeclarativeObject::videoFormat() const {
     return isStopped()
         ? QString()
-        : mpvGetProperty(QLatin1String("video-format")).toString();
+        : mpvCachedProperty<QString>(MpvProperty::VideoFormat);
 }
 
 MpvDeclarativeObject::MpvCallType MpvDeclarativeObject::mpvCallType() const {
@@ -621,7 +2832,7 @@ MpvDeclarativeObject::MpvCallType MpvDeclarativeObject::mpvCallType() const {
 MpvDeclarativeObject::MediaTracks MpvDeclarativeObject::mediaTracks() const {
     MediaTracks mediaTracks;
     QVariantList trackList =
-        mpvGetProperty(QLatin1String("track-list")).toList();
+        mpvCachedProperty<QVariant>(MpvProperty::TrackList).toList();
     for (const auto &track : trackList) {
         const auto &trackInfo = track.toMap();
         if ((trackInfo["type"] != QLatin1String("video")) &&
@@ -674,7 +2885,7 @@ MpvDeclarativeObject::MediaTracks MpvDeclarativeObject::mediaTracks() const {
 MpvDeclarativeObject::Chapters MpvDeclarativeObject::chapters() const {
     Chapters chapters;
     QVariantList chapterList =
-        mpvGetProperty(QLatin1String("chapter-list")).toList();
+        mpvCachedProperty<QVariant>(MpvProperty::ChapterList).toList();
     for (const auto &chapter : chapterList) {
         const auto &chapterInfo = chapter.toMap();
         SingleTrackInfo singleTrackInfo;
@@ -687,7 +2898,8 @@ MpvDeclarativeObject::Chapters MpvDeclarativeObject::chapters() const {
 
 MpvDeclarativeObject::Metadata MpvDeclarativeObject::metadata() const {
     Metadata metadata;
-    QVariantMap metadataMap = mpvGetProperty(QLatin1String("metadata")).toMap();
+    QVariantMap metadataMap =
+        mpvCachedProperty<QVariant>(MpvProperty::Metadata).toMap();
     auto iterator = metadataMap.constBegin();
     while (iterator != metadataMap.constEnd()) {
         metadata[iterator.key()] = iterator.value();
@@ -699,20 +2911,92 @@ MpvDeclarativeObject::Metadata MpvDeclarativeObject::metadata() const {
 qreal MpvDeclarativeObject::avsync() const {
     return isStopped()
         ? 0.0
-        : qMax(mpvGetProperty(QLatin1String("avsync")).toReal(), 0.0);
+        : qMax(mpvCachedProperty<double>(MpvProperty::Avsync), 0.0);
 }
 
 int MpvDeclarativeObject::percentPos() const {
-    return isStopped()
-        ? 0
-        : qMin(qMax(mpvGetProperty(QLatin1String("percent-pos")).toInt(), 0),
-               100);
+    if (isStopped()) {
+        return 0;
+    }
+    return qMin(
+        qMax(qRound(mpvCachedProperty<double>(MpvProperty::PercentPos)), 0),
+        100);
 }
 
 qreal MpvDeclarativeObject::estimatedVfFps() const {
     return isStopped()
         ? 0.0
-        : qMax(mpvGetProperty(QLatin1String("estimated-vf-fps")).toReal(), 0.0);
+        : qMax(mpvCachedProperty<double>(MpvProperty::EstimatedVfFps), 0.0);
+}
+
+int MpvDeclarativeObject::eventBatchSize() const {
+    return currentEventBatchSize;
+}
+
+int MpvDeclarativeObject::eventBatchTimeBudget() const {
+    return currentEventBatchTimeBudget;
+}
+
+bool MpvDeclarativeObject::scrubbing() const {
+    return currentScrubbing;
+}
+
+int MpvDeclarativeObject::seekLatency() const {
+    return currentSeekLatency;
+}
+
+bool MpvDeclarativeObject::asynchronousInitialization() const {
+    return currentAsynchronousInitialization;
+}
+
+int MpvDeclarativeObject::handlePoolSize() const {
+    return mpv::qt::handle_pool::instance().capacity();
+}
+
+bool MpvDeclarativeObject::directRendering() const {
+    return currentDirectRendering;
+}
+
+bool MpvDeclarativeObject::frameReadbackEnabled() const {
+    return frameReadback;
+}
+
+int MpvDeclarativeObject::readbackFrameCount() const {
+    return readbackFrames.loadAcquire();
+}
+
+int MpvDeclarativeObject::droppedReadbackFrameCount() const {
+    return droppedReadbackFrames.loadAcquire();
+}
+
+void MpvDeclarativeObject::setFrameSink(MpvFrameSink *sink) {
+    // Picked up by the renderer on the next synchronization.
+    frameSink = sink;
+    update();
+}
+
+int MpvDeclarativeObject::screenshotConcurrency() const {
+    return screenshotPool.maxThreadCount();
+}
+
+int MpvDeclarativeObject::screenshotQueueDepth() const {
+    return currentScreenshotQueueDepth;
+}
+
+MpvDeclarativeObject::RenderBackend
+MpvDeclarativeObject::renderBackend() const {
+    return currentRenderBackend;
+}
+
+QVariantMap MpvDeclarativeObject::notificationRates() const {
+    QVariantMap rates;
+    for (int i = 0; i < propertyThrottles.size(); ++i) {
+        if (propertyThrottles.at(i).rate != 0.0) {
+            rates.insert(QLatin1String(mpvProperties[i].name),
+                         propertyThrottles.at(i).rate);
+        }
+    }
+    return rates;
 }
 
 bool MpvDeclarativeObject::open(const QUrl &url) {
@@ -728,11 +3012,44 @@ bool MpvDeclarativeObject::open(const QUrl &url) {
     return true;
 }
 
+bool MpvDeclarativeObject::open(const QUrl &url,
+                                const QVariantMap &fileOptions) {
+    if (!url.isValid()) {
+        return false;
+    }
+    if (fileOptions.isEmpty()) {
+        return open(url);
+    }
+    // loadfile takes the options as "key=value,..." after other optional
+    // arguments which changed between mpv versions, so use named arguments.
+    QVariantMap options;
+    for (auto it = fileOptions.cbegin(); it != fileOptions.cend(); ++it) {
+        options.insert(it.key(), it.value().toString());
+    }
+    const bool result = mpvSendCommandNode(QVariantMap{
+        {QStringLiteral("name"), QStringLiteral("loadfile")},
+        {QStringLiteral("url"),
+         url.isLocalFile() ? url.toLocalFile() : url.url()},
+        {QStringLiteral("flags"), QStringLiteral("replace")},
+        {QStringLiteral("options"), options}});
+    if (!result) {
+        return false;
+    }
+    if (url != currentSource) {
+        currentSource = url;
+        Q_EMIT sourceChanged();
+    }
+    if (!isPlaying()) {
+        play();
+    }
+    return true;
+}
+
 bool MpvDeclarativeObject::play() {
     if (!isPaused() || !currentSource.isValid()) {
         return false;
     }
-    const bool result = mpvSetProperty(QLatin1String("pause"), false);
+    const bool result = mpvSetProperty<bool>(QLatin1String("pause"), false);
     if (result) {
         Q_EMIT playing();
     }
@@ -756,7 +3073,7 @@ bool MpvDeclarativeObject::pause() {
     if (!isPlaying()) {
         return false;
     }
-    const bool result = mpvSetProperty(QLatin1String("pause"), true);
+    const bool result = mpvSetProperty<bool>(QLatin1String("pause"), true);
     if (result) {
         Q_EMIT paused();
     }
@@ -767,7 +3084,7 @@ bool MpvDeclarativeObject::stop() {
     if (isStopped()) {
         return false;
     }
-    const bool result = mpvSendCommand(QVariantList{"stop"});
+    const bool result = mpvSendCommand({QStringLiteral("stop")});
     if (result) {
         Q_EMIT stopped();
     }
@@ -779,18 +3096,31 @@ bool MpvDeclarativeObject::seek(qint64 value, bool absolute, bool percent) {
     if (isStopped()) {
         return false;
     }
-    QStringList arguments;
-    arguments.append(percent ? "absolute-percent"
-                             : (absolute ? "absolute" : "relative"));
+    if (!absolute && !percent && (pendingSeekPosition >= 0)) {
+        // Queued seeks replace each other, so an offset must not depend on
+        // one that may never be sent.
+        value += pendingSeekPosition;
+        absolute = true;
+    }
+    const QString flags = percent
+        ? QStringLiteral("absolute-percent")
+        : (absolute ? QStringLiteral("absolute") : QStringLiteral("relative"));
     const qint64 min = (absolute || percent) ? 0 : -position();
     const qint64 max =
         percent ? 100 : (absolute ? duration() : duration() - position());
-    return mpvSendCommand(
-        QVariantList{"seek", qMin(qMax(value, min), max), arguments});
+    value = qMin(qMax(value, min), max);
+    pendingSeekPosition =
+        percent ? -1 : (absolute ? value : position() + value);
+    return mpvSendCoalesced(
+        CoalescedRequest::Seek,
+        {QStringLiteral("seek"), QString::number(value), flags});
 }
 
 bool MpvDeclarativeObject::seekAbsolute(qint64 position) {
-    if (isStopped() || position == this->position()) {
+    // While seeking, position() is still the old position.
+    if (isStopped() ||
+        (!isCoalescedRequestPending(CoalescedRequest::Seek) &&
+         (position == this->position()))) {
         return false;
     }
     return seek(qMin(qMax(position, qint64(0)), duration()), true);
@@ -804,19 +3134,61 @@ bool MpvDeclarativeObject::seekRelative(qint64 offset) {
 }
 
 bool MpvDeclarativeObject::seekPercent(int percent) {
-    if (isStopped() || percent == this->percentPos()) {
+    if (isStopped() ||
+        (!isCoalescedRequestPending(CoalescedRequest::Seek) &&
+         (percent == this->percentPos()))) {
         return false;
     }
     return seek(qMin(qMax(percent, 0), 100), true, true);
 }
 
+bool MpvDeclarativeObject::beginScrub() {
+    if (isStopped() || scrubbing()) {
+        return false;
+    }
+    currentScrubbing = true;
+    scrubPosition = -1.0;
+    Q_EMIT scrubbingChanged();
+    return true;
+}
+
+bool MpvDeclarativeObject::scrubTo(qreal position) {
+    if (isStopped() || !scrubbing()) {
+        return false;
+    }
+    scrubPosition = qMin(qMax(position, 0.0),
+                         mpvCachedProperty<double>(MpvProperty::Duration));
+    return mpvSeekTo(scrubPosition, QStringLiteral("absolute+keyframes"));
+}
+
+bool MpvDeclarativeObject::endScrub() {
+    if (!scrubbing()) {
+        return false;
+    }
+    currentScrubbing = false;
+    Q_EMIT scrubbingChanged();
+    if (isStopped() || (scrubPosition < 0.0)) {
+        return true;
+    }
+    // Replaces a keyframe seek still queued, so this is the last one done.
+    return mpvSeekTo(scrubPosition, QStringLiteral("absolute+exact"));
+}
+
+bool MpvDeclarativeObject::mpvSeekTo(qreal position, const QString &flags) {
+    pendingSeekPosition = qRound64(position);
+    return mpvSendCoalesced(CoalescedRequest::Seek,
+                            {QStringLiteral("seek"),
+                             QString::number(position, 'f', 3), flags});
+}
+
 bool MpvDeclarativeObject::screenshot() {
     if (isStopped()) {
         return false;
     }
     // Replace "subtitles" with "video" if you don't want to include subtitles
     // when screenshotting.
-    return mpvSendCommand(QVariantList{"screenshot", "subtitles"});
+    return mpvSendCommand(
+        {QStringLiteral("screenshot"), QStringLiteral("subtitles")});
 }
 
 bool MpvDeclarativeObject::screenshotToFile(const QString &filePath) {
@@ -824,17 +3196,236 @@ bool MpvDeclarativeObject::screenshotToFile(const QString &filePath) {
         return false;
     }
     // libmpv's default: including subtitles when making a screenshot.
-    return mpvSendCommand(
-        QVariantList{"screenshot-to-file", filePath, "subtitles"});
+    return mpvSendCommand({QStringLiteral("screenshot-to-file"), filePath,
+                           QStringLiteral("subtitles")});
+}
+
+qint64
+MpvDeclarativeObject::grabFrame(MpvDeclarativeObject::ScreenshotMode mode,
+                                const QJSValue &callback) {
+    if (mpvInitState != MpvInitState::Initialized) {
+        return MPV_ERROR_UNINITIALIZED;
+    }
+    if (isStopped()) {
+        return MPV_ERROR_NOTHING_TO_PLAY;
+    }
+    const auto id = qint64(nextAsyncRequestId());
+    pendingFrameGrabs.insert(id, callback);
+    // mpv's async commands can't hand out their result beyond the reply
+    // event, so the synchronous call runs on a worker thread instead and the
+    // image takes over the result.
+    const mpv::qt::Handle handle = mpv;
+    const QByteArray flags = screenshotModeName(mode);
+    const QPointer<MpvDeclarativeObject> guard(this);
+    QThreadPool::globalInstance()->start([handle, flags, guard, id]() {
+        QImage image;
+        const int errorCode = grabScreenshot(handle, flags, &image);
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [guard, id, errorCode, image]() {
+                if (guard != nullptr) {
+                    guard->finishFrameGrab(id, errorCode, image);
+                }
+            },
+            Qt::QueuedConnection);
+    });
+    return id;
+}
+
+qint64 MpvDeclarativeObject::screenshotToFileAsync(
+    const QString &filePath, MpvDeclarativeObject::ScreenshotMode mode) {
+    if (filePath.isEmpty()) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    if (mpvInitState != MpvInitState::Initialized) {
+        return MPV_ERROR_UNINITIALIZED;
+    }
+    if (isStopped()) {
+        return MPV_ERROR_NOTHING_TO_PLAY;
+    }
+    // Drop captures instead of piling them up when encoding can't keep up.
+    if (pendingScreenshots >= screenshotQueueDepth()) {
+        qWarning().noquote()
+            << "Too many screenshots are being encoded, dropping:" << filePath;
+        return MPV_ERROR_EVENT_QUEUE_FULL;
+    }
+    ++pendingScreenshots;
+    const auto id = qint64(nextAsyncRequestId());
+    // Encode with the same settings mpv would have used. The file type
+    // follows the extension, like for screenshot-to-file.
+    QByteArray format = QFileInfo(filePath).suffix().toLower().toLatin1();
+    if (format.isEmpty()) {
+        format = screenshotFormat().toLatin1();
+    }
+    int quality = -1;
+    if (format == "png") {
+        // Qt derives the zlib level from the quality the other way round.
+        quality = 100 - qRound(screenshotPngCompression() * 91.0 / 9.0);
+    } else if ((format == "jpg") || (format == "jpeg")) {
+        quality = screenshotJpegQuality();
+    }
+    const mpv::qt::Handle handle = mpv;
+    const QByteArray flags = screenshotModeName(mode);
+    const QPointer<MpvDeclarativeObject> guard(this);
+    screenshotPool.start([handle, flags, guard, id, filePath, format,
+                          quality]() {
+        QElapsedTimer timer;
+        timer.start();
+        QImage image;
+        int errorCode = grabScreenshot(handle, flags, &image);
+        const auto grabTime = int(timer.restart());
+        if (errorCode >= 0) {
+            QImageWriter writer(filePath, format);
+            writer.setQuality(quality);
+            if (!writer.write(image)) {
+                errorCode = MPV_ERROR_GENERIC;
+            }
+        }
+        const auto encodeTime = int(timer.elapsed());
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [guard, id, errorCode, filePath, grabTime, encodeTime]() {
+                if (guard == nullptr) {
+                    return;
+                }
+                --guard->pendingScreenshots;
+                if (errorCode < 0) {
+                    qWarning().noquote()
+                        << "Failed to save a screenshot:" << filePath;
+                }
+                Q_EMIT guard->screenshotSaved(id, errorCode, filePath,
+                                              grabTime, encodeTime);
+            },
+            Qt::QueuedConnection);
+    });
+    return id;
+}
+
+void MpvDeclarativeObject::finishFrameGrab(qint64 id, int errorCode,
+                                           const QImage &image) {
+    const QJSValue callback = pendingFrameGrabs.take(id);
+    if (errorCode < 0) {
+        qWarning().noquote()
+            << "Failed to grab a frame from mpv:"
+            << QString::fromUtf8(mpv_error_string(errorCode));
+    }
+    Q_EMIT frameGrabbed(id, errorCode, image);
+    callJsCallback(callback, QVariant::fromValue(image), errorCode,
+                   QStringLiteral("screenshot-raw"));
+}
+
+QVariantMap MpvDeclarativeObject::playbackSnapshot() const {
+    const PlaybackSnapshot &snapshot = currentPlaybackSnapshot;
+    return QVariantMap{
+        {QLatin1String("playbackState"),
+         QVariant::fromValue(snapshot.playbackState)},
+        {QLatin1String("mediaStatus"),
+         QVariant::fromValue(snapshot.mediaStatus)},
+        {QLatin1String("duration"), snapshot.duration},
+        // Cached while their notify signals are connected, read from mpv
+        // otherwise.
+        {QLatin1String("position"), position()},
+        {QLatin1String("percentPos"), percentPos()},
+        {QLatin1String("avsync"), avsync()},
+        {QLatin1String("seekable"), snapshot.seekable},
+        {QLatin1String("videoSize"), snapshot.videoSize}};
+}
+
+bool MpvDeclarativeObject::getPropertyAsync(const QString &name,
+                                            const QJSValue &callback) {
+    if (!callback.isCallable()) {
+        qWarning().noquote()
+            << "getPropertyAsync() needs a callback function.";
+        return false;
+    }
+    PendingPropertyGet request;
+    request.name = name;
+    request.callback = callback;
+    return (mpvGetPropertyAsync(name, request) >= 0);
+}
+
+QFuture<QVariant> MpvDeclarativeObject::getPropertyAsync(const QString &name) {
+    PendingPropertyGet request;
+    request.name = name;
+    request.promise.reportStarted();
+    const QFuture<QVariant> future = request.promise.future();
+    const int errorCode = mpvGetPropertyAsync(name, request);
+    if (errorCode < 0) {
+        finishPropertyGet(
+            request, QVariant::fromValue(mpv::qt::ErrorReturn(errorCode)));
+    }
+    return future;
+}
+
+qint64 MpvDeclarativeObject::commandAsync(const QVariant &arguments,
+                                          const QJSValue &callback) {
+    if (commandName(arguments).isEmpty()) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    const MpvRequestRoute route = stageCommand(arguments);
+    if (route != MpvRequestRoute::Send) {
+        return (route == MpvRequestRoute::Staged) ? 0
+                                                  : MPV_ERROR_UNINITIALIZED;
+    }
+    qDebug().noquote() << "Sending a command to mpv asynchronously:"
+                       << arguments;
+    return mpvCommandAsync(arguments, callback);
+}
+
+qint64 MpvDeclarativeObject::setPropertyAsync(const QString &name,
+                                              const QVariant &value,
+                                              const QJSValue &callback) {
+    if (name.isEmpty() || value.isNull() || !value.isValid()) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    const MpvRequestRoute route = stageOption(name, value);
+    if (route != MpvRequestRoute::Send) {
+        return (route == MpvRequestRoute::Staged) ? 0
+                                                  : MPV_ERROR_UNINITIALIZED;
+    }
+    qDebug().noquote() << "Setting a property for mpv asynchronously:"
+                       << name << "to:" << value;
+    return mpvSetPropertyAsync(name, value, callback);
+}
+
+bool MpvDeclarativeObject::setProperties(const QVariantMap &properties) {
+    if (properties.isEmpty()) {
+        return false;
+    }
+    bool result = true;
+    PropertyBatch batch;
+    for (auto it = properties.cbegin(); it != properties.cend(); ++it) {
+        const qint64 id = setPropertyAsync(it.key(), it.value());
+        if (id < 0) {
+            qWarning().noquote()
+                << "Failed to set a property for mpv:" << it.key();
+            result = false;
+            continue;
+        }
+        // Staged until mpv is initialized, nothing to wait for.
+        if (id == 0) {
+            continue;
+        }
+        batch.pendingIds.insert(quint64(id));
+        const int index = mpvPropertyIndex(it.key());
+        if ((index >= 0) && (mpvProperties[index].notifySignal != nullptr) &&
+            !batch.notifySignals.contains(mpvProperties[index].notifySignal)) {
+            batch.notifySignals.append(mpvProperties[index].notifySignal);
+        }
+    }
+    if (!batch.pendingIds.isEmpty()) {
+        pendingPropertyBatches.append(batch);
+    }
+    return result;
 }
 
 void MpvDeclarativeObject::setSource(const QUrl &source) {
     if (!source.isValid() || (source == currentSource)) {
         return;
     }
-    const bool result = mpvSendCommand(QVariantList{
-        "loadfile",
-        source.isLocalFile() ? source.toLocalFile() : source.url()});
+    const bool result = mpvSendCommand(
+        {QStringLiteral("loadfile"),
+         source.isLocalFile() ? source.toLocalFile() : source.url()});
     if (result) {
         currentSource = source;
         Q_EMIT sourceChanged();
@@ -845,7 +3436,7 @@ void MpvDeclarativeObject::setMute(bool mute) {
     if (mute == this->mute()) {
         return;
     }
-    mpvSetProperty(QLatin1String("mute"), mute);
+    mpvSetProperty<bool>(QLatin1String("mute"), mute);
 }
 
 void MpvDeclarativeObject::setPlaybackState(
@@ -898,12 +3489,14 @@ void MpvDeclarativeObject::setLogLevel(
         level = QLatin1String("info");
         break;
     }
-    const bool result1 =
-        mpvSetProperty(QLatin1String("terminal"), level != QLatin1String("no"));
-    const bool result2 = mpvSetProperty(QLatin1String("msg-level"),
-                                        QStringLiteral("all=%1").arg(level));
+    const bool result1 = mpvSetProperty<bool>(QLatin1String("terminal"),
+                                              level != QLatin1String("no"));
+    const bool result2 = mpvSetProperty<QString>(
+        QLatin1String("msg-level"), QStringLiteral("all=%1").arg(level));
+    // Requested again if the handle is swapped for a pooled one.
+    logMessageLevel = level.toUtf8();
     const int result3 =
-        mpv_request_log_messages(mpv, level.toUtf8().constData());
+        mpv_request_log_messages(mpv, logMessageLevel.constData());
     if (result1 && result2 && (result3 >= 0)) {
         Q_EMIT logLevelChanged();
     } else {
@@ -912,121 +3505,127 @@ void MpvDeclarativeObject::setLogLevel(
 }
 
 void MpvDeclarativeObject::setPosition(qint64 position) {
-    if (isStopped() || position == this->position()) {
-        return;
-    }
-    seek(qMin(qMax(position, qint64(0)), duration()));
+    seekAbsolute(position);
 }
 
 void MpvDeclarativeObject::setVolume(int volume) {
-    if (volume == this->volume()) {
+    // The cached value lags behind while a change is in flight.
+    if (!isCoalescedRequestPending(CoalescedRequest::Volume) &&
+        (volume == this->volume())) {
         return;
     }
-    mpvSetProperty(QLatin1String("volume"), qMin(qMax(volume, 0), 100));
+    mpvSendCoalesced(CoalescedRequest::Volume,
+                     {QStringLiteral("set"), QStringLiteral("volume"),
+                      QString::number(qMin(qMax(volume, 0), 100))});
 }
 
 void MpvDeclarativeObject::setHwdec(const QString &hwdec) {
     if (hwdec.isEmpty() || hwdec == this->hwdec()) {
         return;
     }
-    mpvSetProperty(QLatin1String("hwdec"), hwdec);
+    mpvSetProperty<QString>(QLatin1String("hwdec"), hwdec);
 }
 
 void MpvDeclarativeObject::setVid(int vid) {
     if (isStopped() || vid == this->vid()) {
         return;
     }
-    mpvSetProperty(QLatin1String("vid"), qMax(vid, 0));
+    mpvSetProperty<qint64>(QLatin1String("vid"), qMax(vid, 0));
 }
 
 void MpvDeclarativeObject::setAid(int aid) {
     if (isStopped() || aid == this->aid()) {
         return;
     }
-    mpvSetProperty(QLatin1String("aid"), qMax(aid, 0));
+    mpvSetProperty<qint64>(QLatin1String("aid"), qMax(aid, 0));
 }
 
 void MpvDeclarativeObject::setSid(int sid) {
     if (isStopped() || sid == this->sid()) {
         return;
     }
-    mpvSetProperty(QLatin1String("sid"), qMax(sid, 0));
+    mpvSetProperty<qint64>(QLatin1String("sid"), qMax(sid, 0));
 }
 
 void MpvDeclarativeObject::setVideoRotate(int videoRotate) {
     if (isStopped() || videoRotate == this->videoRotate()) {
         return;
     }
-    mpvSetProperty(QLatin1String("video-rotate"),
-                   qMin(qMax(videoRotate, 0), 359));
+    mpvSetProperty<qint64>(QLatin1String("video-rotate"),
+                           qMin(qMax(videoRotate, 0), 359));
 }
 
 void MpvDeclarativeObject::setVideoAspect(qreal videoAspect) {
     if (isStopped() || videoAspect == this->videoAspect()) {
         return;
     }
-    mpvSetProperty(QLatin1String("video-aspect"), qMax(videoAspect, 0.0));
+    mpvSetProperty<double>(QLatin1String("video-aspect"),
+                           qMax(videoAspect, 0.0));
 }
 
 void MpvDeclarativeObject::setSpeed(qreal speed) {
-    if (isStopped() || speed == this->speed()) {
+    if (isStopped() ||
+        (!isCoalescedRequestPending(CoalescedRequest::Speed) &&
+         (speed == this->speed()))) {
         return;
     }
-    mpvSetProperty(QLatin1String("speed"), qMax(speed, 0.0));
+    mpvSendCoalesced(CoalescedRequest::Speed,
+                     {QStringLiteral("set"), QStringLiteral("speed"),
+                      QString::number(qMax(speed, 0.0))});
 }
 
 void MpvDeclarativeObject::setDeinterlace(bool deinterlace) {
     if (deinterlace == this->deinterlace()) {
         return;
     }
-    mpvSetProperty(QLatin1String("deinterlace"), deinterlace);
+    mpvSetProperty<bool>(QLatin1String("deinterlace"), deinterlace);
 }
 
 void MpvDeclarativeObject::setAudioExclusive(bool audioExclusive) {
     if (audioExclusive == this->audioExclusive()) {
         return;
     }
-    mpvSetProperty(QLatin1String("audio-exclusive"), audioExclusive);
+    mpvSetProperty<bool>(QLatin1String("audio-exclusive"), audioExclusive);
 }
 
 void MpvDeclarativeObject::setAudioFileAuto(const QString &audioFileAuto) {
     if (audioFileAuto.isEmpty() || audioFileAuto == this->audioFileAuto()) {
         return;
     }
-    mpvSetProperty(QLatin1String("audio-file-auto"), audioFileAuto);
+    mpvSetProperty<QString>(QLatin1String("audio-file-auto"), audioFileAuto);
 }
 
 void MpvDeclarativeObject::setSubAuto(const QString &subAuto) {
     if (subAuto.isEmpty() || subAuto == this->subAuto()) {
         return;
     }
-    mpvSetProperty(QLatin1String("sub-auto"), subAuto);
+    mpvSetProperty<QString>(QLatin1String("sub-auto"), subAuto);
 }
 
 void MpvDeclarativeObject::setSubCodepage(const QString &subCodepage) {
     if (subCodepage.isEmpty() || subCodepage == this->subCodepage()) {
         return;
     }
-    mpvSetProperty(QLatin1String("sub-codepage"),
-                   subCodepage.startsWith(QLatin1Char('+'))
-                       ? subCodepage
-                       : (subCodepage.startsWith("cp")
-                              ? QLatin1Char('+') + subCodepage
-                              : subCodepage));
+    mpvSetProperty<QString>(QLatin1String("sub-codepage"),
+                            subCodepage.startsWith(QLatin1Char('+'))
+                                ? subCodepage
+                                : (subCodepage.startsWith("cp")
+                                       ? QLatin1Char('+') + subCodepage
+                                       : subCodepage));
 }
 
 void MpvDeclarativeObject::setVo(const QString &vo) {
     if (vo.isEmpty() || vo == this->vo()) {
         return;
     }
-    mpvSetProperty(QLatin1String("vo"), vo);
+    mpvSetProperty<QString>(QLatin1String("vo"), vo);
 }
 
 void MpvDeclarativeObject::setAo(const QString &ao) {
     if (ao.isEmpty() || ao == this->ao()) {
         return;
     }
-    mpvSetProperty(QLatin1String("ao"), ao);
+    mpvSetProperty<QString>(QLatin1String("ao"), ao);
 }
 
 void MpvDeclarativeObject::setScreenshotFormat(
@@ -1035,7 +3634,8 @@ void MpvDeclarativeObject::setScreenshotFormat(
         screenshotFormat == this->screenshotFormat()) {
         return;
     }
-    mpvSetProperty(QLatin1String("screenshot-format"), screenshotFormat);
+    mpvSetProperty<QString>(QLatin1String("screenshot-format"),
+                            screenshotFormat);
 }
 
 void MpvDeclarativeObject::setScreenshotPngCompression(
@@ -1043,8 +3643,8 @@ void MpvDeclarativeObject::setScreenshotPngCompression(
     if (screenshotPngCompression == this->screenshotPngCompression()) {
         return;
     }
-    mpvSetProperty(QLatin1String("screenshot-png-compression"),
-                   qMin(qMax(screenshotPngCompression, 0), 9));
+    mpvSetProperty<qint64>(QLatin1String("screenshot-png-compression"),
+                           qMin(qMax(screenshotPngCompression, 0), 9));
 }
 
 void MpvDeclarativeObject::setScreenshotTemplate(
@@ -1053,7 +3653,8 @@ void MpvDeclarativeObject::setScreenshotTemplate(
         screenshotTemplate == this->screenshotTemplate()) {
         return;
     }
-    mpvSetProperty(QLatin1String("screenshot-template"), screenshotTemplate);
+    mpvSetProperty<QString>(QLatin1String("screenshot-template"),
+                            screenshotTemplate);
 }
 
 void MpvDeclarativeObject::setScreenshotDirectory(
@@ -1062,35 +3663,50 @@ void MpvDeclarativeObject::setScreenshotDirectory(
         screenshotDirectory == this->screenshotDirectory()) {
         return;
     }
-    mpvSetProperty(QLatin1String("screenshot-directory"), screenshotDirectory);
+    mpvSetProperty<QString>(QLatin1String("screenshot-directory"),
+                            screenshotDirectory);
 }
 
 void MpvDeclarativeObject::setProfile(const QString &profile) {
     if (profile.isEmpty() || profile == this->profile()) {
         return;
     }
-    mpvSendCommand(QVariantList{"apply-profile", profile});
+    // The profile option is only meaningful before initialization.
+    if (stageOption(QStringLiteral("profile"), profile) !=
+        MpvRequestRoute::Send) {
+        return;
+    }
+    mpvSendCommand({QStringLiteral("apply-profile"), profile});
 }
 
 void MpvDeclarativeObject::setHrSeek(bool hrSeek) {
     if (hrSeek == this->hrSeek()) {
         return;
     }
-    mpvSetProperty(QLatin1String("hr-seek"), hrSeek ? "yes" : "no");
+    mpvSetProperty<QString>(QLatin1String("hr-seek"),
+                            hrSeek ? QStringLiteral("yes")
+                                   : QStringLiteral("no"));
+}
+
+void MpvDeclarativeObject::setVideoSync(const QString &videoSync) {
+    if (videoSync.isEmpty() || (videoSync == this->videoSync())) {
+        return;
+    }
+    mpvSetProperty<QString>(QLatin1String("video-sync"), videoSync);
 }
 
 void MpvDeclarativeObject::setYtdl(bool ytdl) {
     if (ytdl == this->ytdl()) {
         return;
     }
-    mpvSetProperty(QLatin1String("ytdl"), ytdl);
+    mpvSetProperty<bool>(QLatin1String("ytdl"), ytdl);
 }
 
 void MpvDeclarativeObject::setLoadScripts(bool loadScripts) {
     if (loadScripts == this->loadScripts()) {
         return;
     }
-    mpvSetProperty(QLatin1String("load-scripts"), loadScripts);
+    mpvSetProperty<bool>(QLatin1String("load-scripts"), loadScripts);
 }
 
 void MpvDeclarativeObject::setScreenshotTagColorspace(
@@ -1098,16 +3714,16 @@ void MpvDeclarativeObject::setScreenshotTagColorspace(
     if (screenshotTagColorspace == this->screenshotTagColorspace()) {
         return;
     }
-    mpvSetProperty(QLatin1String("screenshot-tag-colorspace"),
-                   screenshotTagColorspace);
+    mpvSetProperty<bool>(QLatin1String("screenshot-tag-colorspace"),
+                         screenshotTagColorspace);
 }
 
 void MpvDeclarativeObject::setScreenshotJpegQuality(int screenshotJpegQuality) {
     if (screenshotJpegQuality == this->screenshotJpegQuality()) {
         return;
     }
-    mpvSetProperty(QLatin1String("screenshot-jpeg-quality"),
-                   qMin(qMax(screenshotJpegQuality, 0), 100));
+    mpvSetProperty<qint64>(QLatin1String("screenshot-jpeg-quality"),
+                           qMin(qMax(screenshotJpegQuality, 0), 100));
 }
 
 void MpvDeclarativeObject::setMpvCallType(
@@ -1120,21 +3736,145 @@ void MpvDeclarativeObject::setMpvCallType(
 }
 
 void MpvDeclarativeObject::setPercentPos(int percentPos) {
-    if (isStopped() || percentPos == this->percentPos()) {
+    seekPercent(percentPos);
+}
+
+void MpvDeclarativeObject::setEventBatchSize(int eventBatchSize) {
+    if (this->eventBatchSize() == eventBatchSize) {
+        return;
+    }
+    currentEventBatchSize = qMax(eventBatchSize, 0);
+    Q_EMIT eventBatchSizeChanged();
+}
+
+void MpvDeclarativeObject::setEventBatchTimeBudget(int eventBatchTimeBudget) {
+    if (this->eventBatchTimeBudget() == eventBatchTimeBudget) {
+        return;
+    }
+    currentEventBatchTimeBudget = qMax(eventBatchTimeBudget, 0);
+    Q_EMIT eventBatchTimeBudgetChanged();
+}
+
+void MpvDeclarativeObject::setAsynchronousInitialization(
+    bool asynchronousInitialization) {
+    if (this->asynchronousInitialization() == asynchronousInitialization) {
+        return;
+    }
+    // Too late to change anything once initialization has started.
+    if (mpvInitState != MpvInitState::Staging) {
+        return;
+    }
+    currentAsynchronousInitialization = asynchronousInitialization;
+    Q_EMIT asynchronousInitializationChanged();
+}
+
+void MpvDeclarativeObject::setHandlePoolSize(int handlePoolSize) {
+    if (this->handlePoolSize() == handlePoolSize) {
+        return;
+    }
+    mpv::qt::handle_pool &pool = mpv::qt::handle_pool::instance();
+    pool.set_capacity(handlePoolSize);
+    // Warm the pool up without blocking the GUI thread.
+    QThread *thread = QThread::create([&pool]() { pool.fill(); });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+    Q_EMIT handlePoolSizeChanged();
+}
+
+void MpvDeclarativeObject::setDirectRendering(bool directRendering) {
+    if (this->directRendering() == directRendering) {
+        return;
+    }
+    currentDirectRendering = directRendering;
+    trackRenderingPathChanges();
+    // The rendering path is picked in updatePaintNode().
+    update();
+    Q_EMIT directRenderingChanged();
+}
+
+void MpvDeclarativeObject::setFrameReadbackEnabled(bool enabled) {
+    if (frameReadbackEnabled() == enabled) {
+        return;
+    }
+    frameReadback = enabled;
+    update();
+    Q_EMIT frameReadbackEnabledChanged();
+}
+
+void MpvDeclarativeObject::setScreenshotConcurrency(int screenshotConcurrency) {
+    if (this->screenshotConcurrency() == screenshotConcurrency) {
+        return;
+    }
+    screenshotPool.setMaxThreadCount(qMax(screenshotConcurrency, 1));
+    Q_EMIT screenshotConcurrencyChanged();
+}
+
+void MpvDeclarativeObject::setScreenshotQueueDepth(int screenshotQueueDepth) {
+    if (this->screenshotQueueDepth() == screenshotQueueDepth) {
+        return;
+    }
+    currentScreenshotQueueDepth = qMax(screenshotQueueDepth, 1);
+    Q_EMIT screenshotQueueDepthChanged();
+}
+
+void MpvDeclarativeObject::setRenderBackend(
+    MpvDeclarativeObject::RenderBackend renderBackend) {
+    if (this->renderBackend() == renderBackend) {
+        return;
+    }
+    currentRenderBackend = renderBackend;
+    Q_EMIT renderBackendChanged();
+}
+
+void MpvDeclarativeObject::setNotificationRates(
+    const QVariantMap &notificationRates) {
+    if (this->notificationRates() == notificationRates) {
         return;
     }
-    mpvSetProperty(QLatin1String("percent-pos"),
-                   qMin(qMax(percentPos, 0), 100));
+    for (PropertyThrottle &throttle : propertyThrottles) {
+        throttle.rate = 0.0;
+    }
+    for (auto it = notificationRates.cbegin(); it != notificationRates.cend();
+         ++it) {
+        const int index = mpvPropertyIndex(it.key());
+        if ((index < 0) || (mpvProperties[index].notifySignal == nullptr)) {
+            qWarning().noquote()
+                << "Can't throttle notifications of property:" << it.key();
+            continue;
+        }
+        propertyThrottles[index].rate = it.value().toReal();
+    }
+    // Properties that are no longer throttled are due right away.
+    flushThrottledProperties();
+    emitPendingPropertySignals();
+    Q_EMIT notificationRatesChanged();
 }
 
 void MpvDeclarativeObject::handleMpvEvents() {
-    // Process all events, until the event queue is empty.
+    // This runs on the GUI thread, so never block here: poll with a zero
+    // timeout and stop once the batch budget is used up. Remaining events
+    // are handled in the next event loop iteration.
+    // Reset first, so that wakeups arriving while draining schedule another
+    // run instead of getting lost.
+    mpvEventsPending.storeRelease(0);
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+    const int maxEvents = eventBatchSize();
+    const qint64 maxNsecs = qint64(eventBatchTimeBudget()) * 1000;
+    int processedEvents = 0;
+    bool queueDrained = false;
     while (mpv != nullptr) {
-        mpv_event *event = mpv_wait_event(mpv, 0.005);
-        // Nothing happened. Happens on timeouts or sporadic wakeups.
+        if (((maxEvents > 0) && (processedEvents >= maxEvents)) ||
+            ((maxNsecs > 0) && (batchTimer.nsecsElapsed() >= maxNsecs))) {
+            break;
+        }
+        mpv_event *event = mpv_wait_event(mpv, 0);
+        // Nothing happened. The event queue is empty.
         if (event->event_id == MPV_EVENT_NONE) {
+            queueDrained = true;
             break;
         }
+        ++processedEvents;
         bool shouldOutput = true;
         switch (event->event_id) {
         // Happens when the player quits. The player enters a state where it
@@ -1142,6 +3882,8 @@ void MpvDeclarativeObject::handleMpvEvents() {
         // fail, and the client should react to this and quit with
         // mpv_destroy() as soon as possible.
         case MPV_EVENT_SHUTDOWN:
+            // No more replies will come, don't hold anything back forever.
+            pendingPropertyBatches.clear();
             break;
         // See mpv_request_log_messages().
         case MPV_EVENT_LOG_MESSAGE:
@@ -1152,16 +3894,19 @@ void MpvDeclarativeObject::handleMpvEvents() {
         // Reply to a mpv_get_property_async() request.
         // See also mpv_event and mpv_event_property.
         case MPV_EVENT_GET_PROPERTY_REPLY:
+            processMpvGetPropertyReply(event);
             shouldOutput = false;
             break;
         // Reply to a mpv_set_property_async() request.
         // (Unlike MPV_EVENT_GET_PROPERTY, mpv_event_property is not used.)
         case MPV_EVENT_SET_PROPERTY_REPLY:
+            processMpvAsyncReply(event);
             shouldOutput = false;
             break;
         // Reply to a mpv_command_async() or mpv_command_node_async() request.
         // See also mpv_event and mpv_event_command.
         case MPV_EVENT_COMMAND_REPLY:
+            processMpvAsyncReply(event);
             shouldOutput = false;
             break;
         // Notification before playback start of a file (before the file is
@@ -1172,15 +3917,23 @@ void MpvDeclarativeObject::handleMpvEvents() {
         // Notification after playback end (after the file was unloaded).
         // See also mpv_event and mpv_event_end_file.
         case MPV_EVENT_END_FILE:
+            // Pending seeks were meant for the file that is gone, and won't
+            // get their MPV_EVENT_PLAYBACK_RESTART.
+            coalescedSlots[static_cast<int>(CoalescedRequest::Seek)] =
+                CoalescedSlot();
+            pendingSeekPosition = -1;
+            // Neither should the notifications of property batches wait for
+            // replies that may have been lost with it.
+            pendingPropertyBatches.clear();
             setMediaStatus(MediaStatus::End);
-            playbackStateChangeEvent();
+            playbackStateEventPending = true;
             break;
         // Notification when the file has been loaded (headers were read
         // etc.), and decoding starts.
         case MPV_EVENT_FILE_LOADED:
             setMediaStatus(MediaStatus::Loaded);
-            Q_EMIT loaded();
-            playbackStateChangeEvent();
+            loadedEventPending = true;
+            playbackStateEventPending = true;
             break;
         // Idle mode was entered. In this mode, no file is played, and the
         // playback core waits for new commands. (The command line player
@@ -1188,7 +3941,7 @@ void MpvDeclarativeObject::handleMpvEvents() {
         // specified. If mpv was started with mpv_create(), idle mode is enabled
         // by default.)
         case MPV_EVENT_IDLE:
-            playbackStateChangeEvent();
+            playbackStateEventPending = true;
             break;
         // Sent every time after a video frame is displayed. Note that
         // currently, this will be sent in lower frequency if there is no video,
@@ -1231,11 +3984,18 @@ void MpvDeclarativeObject::handleMpvEvents() {
         // segment switches. The main purpose is allowing the client to detect
         // when a seek request is finished.
         case MPV_EVENT_PLAYBACK_RESTART:
+            if (isCoalescedRequestPending(CoalescedRequest::Seek)) {
+                currentSeekLatency = int(seekTimer.elapsed());
+                Q_EMIT seekLatencyChanged();
+                // May send the next seek right away.
+                releaseCoalescedRequest(CoalescedRequest::Seek);
+            }
             break;
         // Event sent due to mpv_observe_property().
         // See also mpv_event and mpv_event_property.
         case MPV_EVENT_PROPERTY_CHANGE:
             processMpvPropertyChange(
+                event->reply_userdata,
                 static_cast<mpv_event_property *>(event->data));
             shouldOutput = false;
             break;
@@ -1263,4 +4023,27 @@ void MpvDeclarativeObject::handleMpvEvents() {
                 << QString::fromUtf8(mpv_event_name(event->event_id));
         }
     }
+    if (!queueDrained && (mpv != nullptr)) {
+        // Budget exhausted, continue after the pending GUI work.
+        on_wakeup(this);
+    }
+    if (processedEvents < 1) {
+        return;
+    }
+    updatePlaybackSnapshot();
+    flushThrottledProperties();
+    if (playbackStateEventPending) {
+        // Goes out once, along with the one queued by "pause" or
+        // "idle-active".
+        queuePropertySignal(&MpvDeclarativeObject::playbackStateChanged);
+    }
+    emitPendingPropertySignals();
+    if (loadedEventPending) {
+        loadedEventPending = false;
+        Q_EMIT loaded();
+    }
+    if (playbackStateEventPending) {
+        playbackStateEventPending = false;
+        playbackStateChangeEvent();
+    }
 }
@@ -9,13 +9,41 @@
 #endif
 
 #include "mpvqthelper.hpp"
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureInterface>
 #include <QHash>
+#include <QImage>
+#include <QJSValue>
+#include <QPointer>
 #include <QQuickFramebufferObject>
+#include <QSGTextureProvider>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
 #include <QUrl>
+#include <QVector>
 #include <mpv/client.h>
 #include <mpv/render_gl.h>
 
+QT_FORWARD_DECLARE_CLASS(QScreen)
+
 class MpvRenderer;
+class MpvRenderContext;
+enum class MpvProperty : int;
+
+// Receives the frames read back from the player's FBO, see
+// MpvDeclarativeObject::setFrameSink().
+class MpvFrameSink {
+public:
+    virtual ~MpvFrameSink() = default;
+    // Called on the render thread, a few frames after the frame was rendered.
+    // frame is only valid during the call, copy it to keep it. timestamp is
+    // in mpv_get_time_us() units. Return false to count the frame as
+    // dropped, e.g. when a queue to the consumer is full. Must not block.
+    virtual bool frameReady(const QImage &frame, qint64 timestamp) = 0;
+};
 
 class MpvDeclarativeObject : public QQuickFramebufferObject {
     Q_OBJECT
@@ -75,6 +103,8 @@ class MpvDeclarativeObject : public QQuickFramebufferObject {
     Q_PROPERTY(
         QString profile READ profile WRITE setProfile NOTIFY profileChanged)
     Q_PROPERTY(bool hrSeek READ hrSeek WRITE setHrSeek NOTIFY hrSeekChanged)
+    Q_PROPERTY(QString videoSync READ videoSync WRITE setVideoSync NOTIFY
+                   videoSyncChanged)
     Q_PROPERTY(bool ytdl READ ytdl WRITE setYtdl NOTIFY ytdlChanged)
     Q_PROPERTY(bool loadScripts READ loadScripts WRITE setLoadScripts NOTIFY
                    loadScriptsChanged)
@@ -107,8 +137,39 @@ class MpvDeclarativeObject : public QQuickFramebufferObject {
                    percentPosChanged)
     Q_PROPERTY(
         qreal estimatedVfFps READ estimatedVfFps NOTIFY estimatedVfFpsChanged)
+    Q_PROPERTY(int eventBatchSize READ eventBatchSize WRITE setEventBatchSize
+                   NOTIFY eventBatchSizeChanged)
+    Q_PROPERTY(int eventBatchTimeBudget READ eventBatchTimeBudget WRITE
+                   setEventBatchTimeBudget NOTIFY eventBatchTimeBudgetChanged)
+    Q_PROPERTY(QVariantMap notificationRates READ notificationRates WRITE
+                   setNotificationRates NOTIFY notificationRatesChanged)
+    Q_PROPERTY(bool scrubbing READ scrubbing NOTIFY scrubbingChanged)
+    Q_PROPERTY(int seekLatency READ seekLatency NOTIFY seekLatencyChanged)
+    Q_PROPERTY(bool asynchronousInitialization READ asynchronousInitialization
+                   WRITE setAsynchronousInitialization NOTIFY
+                       asynchronousInitializationChanged)
+    Q_PROPERTY(int handlePoolSize READ handlePoolSize WRITE setHandlePoolSize
+                   NOTIFY handlePoolSizeChanged)
+    Q_PROPERTY(bool directRendering READ directRendering WRITE
+                   setDirectRendering NOTIFY directRenderingChanged)
+    Q_PROPERTY(QSize framebufferSize READ framebufferSize NOTIFY
+                   framebufferSizeChanged)
+    Q_PROPERTY(bool frameReadback READ frameReadbackEnabled WRITE
+                   setFrameReadbackEnabled NOTIFY frameReadbackEnabledChanged)
+    Q_PROPERTY(int readbackFrameCount READ readbackFrameCount NOTIFY
+                   readbackStatisticsChanged)
+    Q_PROPERTY(int droppedReadbackFrameCount READ droppedReadbackFrameCount
+                   NOTIFY readbackStatisticsChanged)
+    Q_PROPERTY(int screenshotConcurrency READ screenshotConcurrency WRITE
+                   setScreenshotConcurrency NOTIFY screenshotConcurrencyChanged)
+    Q_PROPERTY(int screenshotQueueDepth READ screenshotQueueDepth WRITE
+                   setScreenshotQueueDepth NOTIFY screenshotQueueDepthChanged)
+    Q_PROPERTY(MpvDeclarativeObject::RenderBackend renderBackend READ
+                   renderBackend WRITE setRenderBackend NOTIFY
+                       renderBackendChanged)
 
     friend class MpvRenderer;
+    friend class MpvSoftwareNode;
 
     using SingleTrackInfo = QHash<QString, QVariant>;
 
@@ -135,6 +196,12 @@ public:
     enum class MpvCallType { Synchronous, Asynchronous };
     Q_ENUM(MpvCallType)
 
+    enum class RenderBackend { Automatic, OpenGL, Software };
+    Q_ENUM(RenderBackend)
+
+    enum class ScreenshotMode { Video, Subtitles, Window };
+    Q_ENUM(ScreenshotMode)
+
     struct MediaTracks {
         QList<SingleTrackInfo> videoChannels;
         QList<SingleTrackInfo> audioTracks;
@@ -151,7 +218,13 @@ public:
     ~MpvDeclarativeObject() override;
 
     static void on_update(void *ctx);
+    static void on_wakeup(void *ctx);
     [[nodiscard]] Renderer *createRenderer() const override;
+    // Other items can sample the rendered video, so that a stream shown in
+    // several places is only decoded once. Direct rendering is disabled once
+    // the texture has been requested.
+    [[nodiscard]] bool isTextureProvider() const override;
+    [[nodiscard]] QSGTextureProvider *textureProvider() const override;
 
     // Current media's source in QUrl.
     [[nodiscard]] QUrl source() const;
@@ -297,6 +370,10 @@ public:
     // file, such as a chapter seek, but not for relative seeks like the default
     // behavior of arrow keys (default).
     [[nodiscard]] bool hrSeek() const;
+    // --video-sync=<audio|display-resample|...>
+    // How audio and video are synchronized. display-resample by default here,
+    // frames are timed by the swaps reported to mpv.
+    [[nodiscard]] QString videoSync() const;
     // --ytdl=<yes|no>
     // Enable the youtube-dl hook-script. It will look at the input URL, and
     // will play the video located on the website
@@ -417,6 +494,58 @@ public:
     // enabled, or after precise seeking). Files with imprecise timestamps (such
     // as Matroska) might lead to unstable results.
     [[nodiscard]] qreal estimatedVfFps() const;
+    // Maximum number of mpv events processed in one go on the GUI thread. If
+    // more events are queued, the rest is handled in the next event loop
+    // iteration. 0 means no limit.
+    [[nodiscard]] int eventBatchSize() const;
+    // Maximum time, in **MICROSECONDS**, spent processing mpv events in one go
+    // on the GUI thread. 0 means no limit.
+    [[nodiscard]] int eventBatchTimeBudget() const;
+    // Maximum notify signal rate, in Hz, of the throttled mpv properties,
+    // keyed by mpv property name (e.g. "time-pos"). A negative rate means the
+    // refresh rate of the screen. Properties not in the map are notified on
+    // every change.
+    [[nodiscard]] QVariantMap notificationRates() const;
+    // Whether we are between beginScrub() and endScrub().
+    [[nodiscard]] bool scrubbing() const;
+    // Time between sending the last finished seek and mpv resuming playback
+    // from the new position, in **MILLISECONDS**.
+    [[nodiscard]] int seekLatency() const;
+    // Whether mpv_initialize() runs on a worker thread instead of the GUI
+    // thread. Only has an effect if set before the component is completed.
+    [[nodiscard]] bool asynchronousInitialization() const;
+    // Number of initialized mpv handles kept around for new players. This is
+    // process-wide, shared by all instances. Players staging options that
+    // only apply at startup don't take a handle from the pool.
+    [[nodiscard]] int handlePoolSize() const;
+    // Render into the window directly, underneath the scene, instead of an
+    // FBO whenever the item and its ancestors are visible, opaque and not in a
+    // layer, it covers the whole window and nothing is drawn below it.
+    [[nodiscard]] bool directRendering() const;
+    // Size of the FBO the video is rendered into, in pixels. It only changes
+    // once a resize has settled and the item doesn't fit anymore.
+    [[nodiscard]] QSize framebufferSize() const;
+    // Read the rendered frames back from the FBO through a ring of PBOs and
+    // hand them to the frame sink. Only the FBO path is read back, not direct
+    // or software rendering.
+    [[nodiscard]] bool frameReadbackEnabled() const;
+    // Frames handed to the sink, and frames dropped because the GPU or the
+    // sink couldn't keep up.
+    [[nodiscard]] int readbackFrameCount() const;
+    [[nodiscard]] int droppedReadbackFrameCount() const;
+    // Set the receiver of read back frames. Not owned, unset it before
+    // destroying it.
+    void setFrameSink(MpvFrameSink *sink);
+    // Number of screenshots encoded at the same time by
+    // screenshotToFileAsync().
+    [[nodiscard]] int screenshotConcurrency() const;
+    // Maximum number of screenshots waiting to be grabbed or encoded, further
+    // ones are dropped.
+    [[nodiscard]] int screenshotQueueDepth() const;
+    // Whether mpv renders with OpenGL or on the CPU. Automatic picks the
+    // software renderer if there's no hardware accelerated OpenGL. Only takes
+    // effect before the first frame.
+    [[nodiscard]] MpvDeclarativeObject::RenderBackend renderBackend() const;
 
     void setSource(const QUrl &source);
     void setMute(bool mute);
@@ -444,14 +573,28 @@ public:
     void setScreenshotDirectory(const QString &screenshotDirectory);
     void setProfile(const QString &profile);
     void setHrSeek(bool hrSeek);
+    void setVideoSync(const QString &videoSync);
     void setYtdl(bool ytdl);
     void setLoadScripts(bool loadScripts);
     void setScreenshotTagColorspace(bool screenshotTagColorspace);
     void setScreenshotJpegQuality(int screenshotJpegQuality);
     void setMpvCallType(MpvDeclarativeObject::MpvCallType mpvCallType);
     void setPercentPos(int percentPos);
+    void setEventBatchSize(int eventBatchSize);
+    void setEventBatchTimeBudget(int eventBatchTimeBudget);
+    void setNotificationRates(const QVariantMap &notificationRates);
+    void setAsynchronousInitialization(bool asynchronousInitialization);
+    void setHandlePoolSize(int handlePoolSize);
+    void setDirectRendering(bool directRendering);
+    void setRenderBackend(MpvDeclarativeObject::RenderBackend renderBackend);
+    void setFrameReadbackEnabled(bool enabled);
+    void setScreenshotConcurrency(int screenshotConcurrency);
+    void setScreenshotQueueDepth(int screenshotQueueDepth);
 
     Q_INVOKABLE bool open(const QUrl &url);
+    // Load url with per-file options (e.g. {"start": "30", "aid": "2"}),
+    // which only apply while this file is played. Always reloads the file.
+    Q_INVOKABLE bool open(const QUrl &url, const QVariantMap &fileOptions);
     Q_INVOKABLE bool play();
     Q_INVOKABLE bool play(const QUrl &url);
     Q_INVOKABLE bool pause();
@@ -469,10 +612,76 @@ public:
     // relative percent, I will not implement it in a short period of time
     // because I don't think it is useful enough.
     Q_INVOKABLE bool seekPercent(int percent);
+    // Timeline scrubbing. While scrubbing, scrubTo() only seeks to keyframes,
+    // which is much cheaper than decoding up to the exact position, and only
+    // the latest position is kept while a seek is in progress. endScrub()
+    // then does one exact seek to the last position. Positions are in
+    // seconds.
+    Q_INVOKABLE bool beginScrub();
+    Q_INVOKABLE bool scrubTo(qreal position);
+    Q_INVOKABLE bool endScrub();
     Q_INVOKABLE bool screenshot();
     // According to mpv's manual, the file path must contain an extension
     // name, otherwise the behavior is arbitrary.
     Q_INVOKABLE bool screenshotToFile(const QString &filePath);
+    // Grab the current frame as an image, without encoding it to a file.
+    // Returns the request id, or a negative mpv error code. frameGrabbed() is
+    // emitted with the same id, and callback, if given, is called with
+    // (image, error). The image uses mpv's buffer, it's not copied.
+    Q_INVOKABLE qint64 grabFrame(
+        MpvDeclarativeObject::ScreenshotMode mode =
+            MpvDeclarativeObject::ScreenshotMode::Subtitles,
+        const QJSValue &callback = QJSValue());
+    // Grab the current frame and encode it to filePath on a worker thread,
+    // so that neither mpv nor the GUI wait for the encoder. The file type
+    // follows the extension, encoder settings are taken from the screenshot
+    // properties. Returns the request id that screenshotSaved() is emitted
+    // with, or a negative mpv error code.
+    Q_INVOKABLE qint64 screenshotToFileAsync(
+        const QString &filePath,
+        MpvDeclarativeObject::ScreenshotMode mode =
+            MpvDeclarativeObject::ScreenshotMode::Subtitles);
+    // All playback state related values (playbackState, mediaStatus,
+    // duration, position, percentPos, avsync, seekable and videoSize) in one
+    // map, so that progress UIs only need a single call per frame. position,
+    // percentPos and avsync are read from mpv unless they are observed.
+    Q_INVOKABLE QVariantMap playbackSnapshot() const;
+    // Query any mpv property without blocking the GUI thread. callback is
+    // called later with (value, error), error being 0 on success or a
+    // negative mpv error code. Returns false if the request couldn't be sent.
+    Q_INVOKABLE bool getPropertyAsync(const QString &name,
+                                      const QJSValue &callback);
+    // Same for C++. The future holds the property value, or an ErrorReturn
+    // with the error code (see mpv::qt::get_error()).
+    QFuture<QVariant> getPropertyAsync(const QString &name);
+    // Run a mpv command (arguments as for the mpv "command" JSON IPC request)
+    // or set a property asynchronously, whatever mpvCallType is. Returns the
+    // request id, or a negative mpv error code if it couldn't be sent. Before
+    // mpv is initialized, the request is staged and 0 is returned, no reply
+    // is reported for it then. commandFinished() is emitted with the same id
+    // once mpv has handled it, and callback, if given, is called with
+    // (result, error).
+    Q_INVOKABLE qint64 commandAsync(const QVariant &arguments,
+                                    const QJSValue &callback = QJSValue());
+    Q_INVOKABLE qint64 setPropertyAsync(const QString &name,
+                                        const QVariant &value,
+                                        const QJSValue &callback = QJSValue());
+    // Set all the given properties asynchronously in one go. Their change
+    // notifications are held back until mpv has acknowledged every one of
+    // them, so bindings are re-evaluated once for the whole batch.
+    Q_INVOKABLE bool setProperties(const QVariantMap &properties);
+
+protected:
+    // mpv is initialized here, once all the initial property values from
+    // QML have been staged as options.
+    void componentComplete() override;
+    QSGNode *updatePaintNode(QSGNode *node, UpdatePaintNodeData *data) override;
+    void geometryChanged(const QRectF &newGeometry,
+                         const QRectF &oldGeometry) override;
+    // Observe mpv properties only while something is connected to their
+    // notify signals (QML bindings connect to them as well).
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
 
 protected Q_SLOTS:
     void handleMpvEvents();
@@ -481,13 +690,110 @@ private Q_SLOTS:
     void doUpdate();
 
 private:
-    bool mpvSendCommand(const QVariant &arguments);
+    // Create mpv_gl on the render thread. Returns whether it exists.
+    bool initializeRenderContext();
+    // Called on the render thread when mpv_render_context_create() failed
+    // for backend. It isn't retried then.
+    void failRenderContext(MpvDeclarativeObject::RenderBackend backend,
+                           int errorCode);
+    // Called on the GUI thread after that. Automatic falls back from the
+    // software backend to OpenGL, otherwise the player fails like when
+    // mpv_initialize() does.
+    void renderContextFailed(MpvDeclarativeObject::RenderBackend backend,
+                             int errorCode);
+    // Render at the current item size, once it stopped changing.
+    void settleRenderSize();
+    // Called on the GUI thread once screenshot-raw has returned.
+    void finishFrameGrab(qint64 id, int errorCode, const QImage &image);
+    // Backend to create the render context with. Called on the render thread.
+    [[nodiscard]] MpvDeclarativeObject::RenderBackend
+    resolveRenderBackend() const;
+    // Whether the direct rendering path can be used for the next frame.
+    [[nodiscard]] bool canRenderDirectly() const;
+    // Update if the result of canRenderDirectly() changed.
+    void checkRenderingPath();
+    // Call checkRenderingPath() whenever the item or one of its ancestors
+    // changes in a way that matters to canRenderDirectly().
+    void trackRenderingPathChanges();
+    // Let the window clear itself again after rendering directly.
+    void restoreWindowClearing();
+    // Follow the refresh rate of the new window.
+    void handleWindowChanged(QQuickWindow *window);
+    void updateDisplayRefreshRate(QScreen *screen);
+    // Set the staged options and initialize mpv, see componentComplete().
+    void mpvInitialize();
+    // Swap the handle for an initialized one from mpv::qt::handle_pool,
+    // unless an option that only applies at startup was staged. Returns
+    // whether it did.
+    bool adoptPooledHandle();
+    // Called on the GUI thread once mpv_initialize() has returned. Replays
+    // the staged options and commands, unless it failed.
+    void mpvInitialized(int errorCode);
+    // Every request to mpv goes through one of these first. Before mpv is
+    // initialized, property sets are staged as options and commands are kept
+    // to be run afterwards. Once it is, the request is to be sent, unless
+    // initialization failed.
+    enum class MpvRequestRoute { Send, Staged, Refused };
+    MpvRequestRoute stageOption(const QString &name, const QVariant &value);
+    MpvRequestRoute stageCommand(const QVariant &arguments);
+    // Shorthand for mpvSendCommandNode() with a list of strings.
+    bool mpvSendCommand(const QStringList &arguments);
+    // Any command mpv_node, e.g. a map with named arguments.
+    bool mpvSendCommandNode(const QVariant &arguments);
     bool mpvSetProperty(const QString &name, const QVariant &value);
     QVariant mpvGetProperty(const QString &name, bool *ok = nullptr) const;
-    bool mpvObserveProperty(const QString &name);
+    // Typed setter using the native mpv format matching T (double, qint64,
+    // bool or QString) instead of a mpv_node.
+    template <typename T>
+    bool mpvSetProperty(const QString &name, const T &value);
+    // Read an observed property from the cache. T can be double, qint64,
+    // bool, QString or QVariant (for MPV_FORMAT_NODE properties).
+    template <typename T>
+    T mpvCachedProperty(MpvProperty property) const;
+    struct CachedProperty;
+    const CachedProperty &cachedProperty(MpvProperty property) const;
+    void invalidateCachedProperty(const QString &name);
+    bool mpvObserveProperty(const QString &name,
+                            mpv_format format = MPV_FORMAT_NONE,
+                            quint64 id = 0);
+    // Start or stop observing the property at index of the property table.
+    void setPropertyObserved(int index, bool observed);
+    // reply_userdata for a new asynchronous request, never clashes with the
+    // property observation ids.
+    quint64 nextAsyncRequestId();
+    struct PendingPropertyGet;
+    // Returns the mpv error code of sending the request.
+    int mpvGetPropertyAsync(const QString &name,
+                            const PendingPropertyGet &request);
+    void finishPropertyGet(PendingPropertyGet &request, const QVariant &value);
+    // Register a command or property set about to be sent asynchronously.
+    // Returns its reply_userdata, or 0 if too many requests are in flight.
+    quint64 trackAsyncRequest(const QString &name, const QJSValue &callback);
+    template <typename Args>
+    qint64 mpvCommandAsync(const Args &arguments, const QJSValue &callback);
+    template <typename T>
+    qint64 mpvSetPropertyAsync(const QString &name, const T &value,
+                               const QJSValue &callback);
+    void callJsCallback(const QJSValue &callback, const QVariant &result,
+                        int errorCode, const QString &name);
+
+    // Requests driven by sliders, of which only the latest value matters.
+    enum class CoalescedRequest { Seek, Volume, Speed, Count };
+    // Send arguments asynchronously, unless the previous request of the same
+    // kind is still in flight. Then it replaces any request queued behind
+    // that one, and is sent once mpv has handled it.
+    bool mpvSendCoalesced(CoalescedRequest kind, const QStringList &arguments);
+    void releaseCoalescedRequest(CoalescedRequest kind);
+    [[nodiscard]] bool isCoalescedRequestPending(CoalescedRequest kind) const;
+    // Absolute seek to position (in seconds) with the given seek flags
+    // (e.g. "absolute+keyframes"), through the coalesced seek slot.
+    bool mpvSeekTo(qreal position, const QString &flags);
 
     void processMpvLogMessage(mpv_event_log_message *event);
-    void processMpvPropertyChange(mpv_event_property *event);
+    void processMpvPropertyChange(quint64 id, mpv_event_property *event);
+    void processMpvGetPropertyReply(mpv_event *event);
+    // MPV_EVENT_COMMAND_REPLY and MPV_EVENT_SET_PROPERTY_REPLY.
+    void processMpvAsyncReply(mpv_event *event);
 
     [[nodiscard]] bool isLoaded() const;
     [[nodiscard]] bool isPlaying() const;
@@ -503,86 +809,236 @@ private:
     // Never do anything expensive here.
     void audioReconfig();
 
+    // Emits playing(), paused() or stopped(). playbackStateChanged() is
+    // queued with the notify signals instead.
     void playbackStateChangeEvent();
 
+    // Recompute currentPlaybackSnapshot from the property cache. Called once
+    // per batch of mpv events and after synchronous property changes.
+    void updatePlaybackSnapshot();
+
+    void queuePropertySignal(void (MpvDeclarativeObject::*notifySignal)());
+    // Queue the notify signals of throttled properties that are due, and
+    // schedule throttleTimer for the others.
+    void flushThrottledProperties();
+    void emitPendingPropertySignals();
+    // Whether notifySignal belongs to an unfinished setProperties() batch.
+    [[nodiscard]] bool isPropertySignalHeldBack(
+        void (MpvDeclarativeObject::*notifySignal)()) const;
+    // Minimum time between two notifications of a property, in nanoseconds.
+    [[nodiscard]] qint64 notifyInterval(int index) const;
+
 private:
     mpv::qt::Handle mpv;
+    // Owned by renderContext, only used on the render thread.
     mpv_render_context *mpv_gl = nullptr;
+    QSharedPointer<MpvRenderContext> renderContext;
+
+    // Failed is final, commands and property sets are refused then.
+    enum class MpvInitState { Staging, Initializing, Initialized, Failed };
+    MpvInitState mpvInitState = MpvInitState::Staging;
+    // Read by the render thread, which must not create the render context
+    // before mpv is initialized.
+    QAtomicInt mpvReady = 0;
+    // Error of mpv_render_context_create(), 0 as long as it didn't fail.
+    QAtomicInt renderContextError = 0;
+    // The software backend couldn't be created, Automatic picks OpenGL from
+    // the next synchronization on.
+    bool softwareBackendFailed = false;
+    bool currentAsynchronousInitialization = false;
+    QVector<QPair<QString, QVariant>> stagedOptions;
+    QVariantList stagedCommands;
+    bool currentDirectRendering = false;
+    // Path picked by the last updatePaintNode(). Only written while the GUI
+    // thread is blocked.
+    bool renderingDirectly = false;
+    // Doesn't clear itself before rendering while the video is drawn
+    // directly into it.
+    QPointer<QQuickWindow> clearDisabledWindow;
+    QVector<QMetaObject::Connection> renderingPathConnections;
+    // Set on the render thread by textureProvider().
+    QAtomicInt textureProviderRequested = 0;
+    // Provider of the software backend's node, only used on the render
+    // thread. Cleared when the scene graph deletes the node.
+    QPointer<QSGTextureProvider> softwareTextureProvider;
+    MpvDeclarativeObject::RenderBackend currentRenderBackend =
+        MpvDeclarativeObject::RenderBackend::Automatic;
+    // What the render context was created with, never Automatic once the
+    // first frame was drawn. Only accessed on the render thread, and only
+    // written by updatePaintNode().
+    MpvDeclarativeObject::RenderBackend resolvedRenderBackend =
+        MpvDeclarativeObject::RenderBackend::Automatic;
+    // The last frames were rendered directly, the FBO needs a redraw before
+    // it's shown again. Only accessed while the GUI thread is blocked.
+    bool framebufferStale = false;
+    // Size the video is rendered at, in pixels, and the FBO it's rendered
+    // into. Both are read by the render thread during synchronization.
+    QSize renderSize;
+    QSize currentFramebufferSize;
+    QTimer resizeTimer;
+    QMetaObject::Connection screenChangedConnection;
+    // Display refresh interval in microseconds (mpv_get_time_us() units),
+    // read by the render thread. 0 if unknown.
+    QAtomicInteger<qint64> refreshInterval = 0;
+    // Last level given to mpv_request_log_messages().
+    QByteArray logMessageLevel;
+    // Restored to their defaults before the handle goes back to the pool.
+    QSet<QString> changedOptions;
+
+    // Backs the mpv_node trees of commands and property sets, so that they
+    // don't allocate once it has grown to the largest one.
+    mpv::qt::node_arena nodeArena;
+
+    // Set while a handleMpvEvents() / update() call is queued, so that the
+    // mpv callbacks post at most one event each to the GUI thread.
+    QAtomicInt mpvEventsPending = 0;
+    QAtomicInt updatePending = 0;
 
     QUrl currentSource = QUrl();
     MpvDeclarativeObject::MediaStatus currentMediaStatus =
         MpvDeclarativeObject::MediaStatus::NoMedia;
     MpvDeclarativeObject::MpvCallType currentMpvCallType =
         MpvDeclarativeObject::MpvCallType::Synchronous;
+    int currentEventBatchSize = 64;
+    int currentEventBatchTimeBudget = 2000;
+
+    // Derived playback values shared by the composite getters, so that
+    // e.g. position() doesn't have to re-evaluate the playback state and the
+    // duration on every call.
+    struct PlaybackSnapshot {
+        MpvDeclarativeObject::PlaybackState playbackState =
+            MpvDeclarativeObject::PlaybackState::Stopped;
+        MpvDeclarativeObject::MediaStatus mediaStatus =
+            MpvDeclarativeObject::MediaStatus::NoMedia;
+        qint64 duration = 0;
+        bool seekable = false;
+        QSize videoSize = QSize();
+    };
+
+    PlaybackSnapshot currentPlaybackSnapshot;
+
+    // Notify signals and playback state events collected while draining the
+    // event queue. They are emitted after the snapshot has been updated.
+    using NotifySignal = void (MpvDeclarativeObject::*)();
+    QVector<NotifySignal> pendingPropertySignals;
+    bool playbackStateEventPending = false;
+    bool loadedEventPending = false;
+
+    struct PropertyThrottle {
+        // In Hz. 0 means not throttled, negative means screen refresh rate.
+        qreal rate = 0.0;
+        // notifyClock time of the last notification, in nanoseconds.
+        qint64 lastNotified = 0;
+        // Changed since the last notification.
+        bool pending = false;
+    };
+
+    QVector<PropertyThrottle> propertyThrottles;
+    QElapsedTimer notifyClock;
+    QTimer throttleTimer;
+
+    // mpv_get_property_async() requests waiting for their reply, keyed by
+    // reply_userdata.
+    struct PendingPropertyGet {
+        QString name = QString();
+        QJSValue callback = QJSValue();
+        // Only started for the C++ API.
+        QFutureInterface<QVariant> promise = QFutureInterface<QVariant>();
+    };
+
+    QHash<quint64, PendingPropertyGet> pendingPropertyGets;
+
+    // Commands and property sets sent asynchronously, waiting for their
+    // reply, keyed by reply_userdata.
+    struct PendingAsyncRequest {
+        // Command or property name, for diagnostics.
+        QString name = QString();
+        QJSValue callback = QJSValue();
+    };
+
+    QHash<quint64, PendingAsyncRequest> pendingAsyncRequests;
+    // Callbacks of grabFrame(), by request id.
+    QHash<qint64, QJSValue> pendingFrameGrabs;
+    // Read by the renderer during synchronization.
+    bool frameReadback = false;
+    MpvFrameSink *frameSink = nullptr;
+    // Updated by the render thread.
+    QAtomicInt readbackFrames = 0;
+    QAtomicInt droppedReadbackFrames = 0;
+    QThreadPool screenshotPool;
+    int currentScreenshotQueueDepth = 8;
+    int pendingScreenshots = 0;
+    // setProperties() batches with requests not acknowledged yet. The notify
+    // signals of their properties are held back until the last one is in.
+    struct PropertyBatch {
+        QSet<quint64> pendingIds = QSet<quint64>();
+        QVector<NotifySignal> notifySignals = QVector<NotifySignal>();
+    };
+
+    QVector<PropertyBatch> pendingPropertyBatches;
+
+    struct CoalescedSlot {
+        // reply_userdata of the request mpv is working on, 0 if none.
+        quint64 inFlightId = 0;
+        // Latest request waiting for the one in flight, empty if none.
+        QStringList queued = QStringList();
+    };
+
+    QVector<CoalescedSlot> coalescedSlots;
+    // Target of the latest absolute seek not finished yet, in seconds, or -1.
+    // Relative seeks are made relative to it, since position() won't reflect
+    // it until the seek has been done.
+    qint64 pendingSeekPosition = -1;
+
+    bool currentScrubbing = false;
+    // Target of the last scrubTo(), in seconds, or -1.
+    qreal scrubPosition = -1.0;
+    // Started when a seek is sent, read on MPV_EVENT_PLAYBACK_RESTART.
+    QElapsedTimer seekTimer;
+    int currentSeekLatency = 0;
+
+    // A property value in the format it was observed with. Scalars are kept
+    // natively, only MPV_FORMAT_NODE values are converted to QVariant.
+    struct CachedProperty {
+        // MPV_FORMAT_NONE if the property is currently unavailable.
+        mpv_format format = MPV_FORMAT_NONE;
+        double doubleValue = 0.0;
+        qint64 int64Value = 0;
+        bool flagValue = false;
+        QString stringValue = QString();
+        QVariant nodeValue = QVariant();
+        // Whether the value has been received from mpv already.
+        bool valid = false;
+        // Whether mpv_observe_property() is active for it, unobserved values
+        // are queried again on every read.
+        bool observed = false;
+    };
 
-    const QHash<const char *, const char *> properties = {
-        {"dwidth", "videoSizeChanged"},
-        {"dheight", "videoSizeChanged"},
-        {"duration", "durationChanged"},
-        {"time-pos", "positionChanged"},
-        {"volume", "volumeChanged"},
-        {"mute", "muteChanged"},
-        {"seekable", "seekableChanged"},
-        {"hwdec", "hwdecChanged"},
-        {"vid", "vidChanged"},
-        {"aid", "aidChanged"},
-        {"sid", "sidChanged"},
-        {"video-rotate", "videoRotateChanged"},
-        {"video-aspect", "videoAspectChanged"},
-        {"speed", "speedChanged"},
-        {"deinterlace", "deinterlaceChanged"},
-        {"audio-exclusive", "audioExclusiveChanged"},
-        {"audio-file-auto", "audioFileAutoChanged"},
-        {"sub-auto", "subAutoChanged"},
-        {"sub-codepage", "subCodepageChanged"},
-        {"filename", "fileNameChanged"},
-        {"media-title", "mediaTitleChanged"},
-        {"vo", "voChanged"},
-        {"ao", "aoChanged"},
-        {"screenshot-format", "screenshotFormatChanged"},
-        {"screenshot-png-compression", "screenshotPngCompressionChanged"},
-        {"screenshot-template", "screenshotTemplateChanged"},
-        {"screenshot-directory", "screenshotDirectoryChanged"},
-        {"profile", "profileChanged"},
-        {"hr-seek", "hrSeekChanged"},
-        {"ytdl", "ytdlChanged"},
-        {"load-scripts", "loadScriptsChanged"},
-        {"path", "pathChanged"},
-        {"file-format", "fileFormatChanged"},
-        {"file-size", "fileSizeChanged"},
-        {"video-bitrate", "videoBitrateChanged"},
-        {"audio-bitrate", "audioBitrateChanged"},
-        {"audio-device-list", "audioDeviceListChanged"},
-        {"screenshot-tag-colorspace", "screenshotTagColorspaceChanged"},
-        {"screenshot-jpeg-quality", "screenshotJpegQualityChanged"},
-        {"video-format", "videoFormatChanged"},
-        {"pause", "playbackStateChanged"},
-        {"idle-active", "playbackStateChanged"},
-        {"track-list", "mediaTracksChanged"},
-        {"chapter-list", "chaptersChanged"},
-        {"metadata", "metadataChanged"},
-        {"avsync", "avsyncChanged"},
-        {"percent-pos", "percentPosChanged"},
-        {"estimated-vf-fps", "estimatedVfFpsChanged"}};
-
-    // These properties are changing all the time during the playback process.
-    // So we have to add them to the black list, otherwise we'll get huge
-    // message floods.
-    const QStringList propertyBlackList = {
-        QLatin1String("time-pos"),      QLatin1String("playback-time"),
-        QLatin1String("percent-pos"),   QLatin1String("video-bitrate"),
-        QLatin1String("audio-bitrate"), QLatin1String("estimated-vf-fps"),
-        QLatin1String("avsync")};
+    // Last known values of the observed properties, indexed by MpvProperty.
+    // Filled from MPV_EVENT_PROPERTY_CHANGE so the getters don't need to block
+    // on mpv_get_property().
+    mutable QVector<CachedProperty> propertyCache;
 
 Q_SIGNALS:
     void onUpdate();
     void hasMpvEvents();
     void initFinished();
+    // mpv_initialize() or the creation of the renderer failed with error, the
+    // player stays unusable.
+    void initFailed(int error);
 
     void loaded();
     void playing();
     void paused();
     void stopped();
+    // An asynchronous command or property set has been handled by mpv. error
+    // is 0 on success, otherwise a negative mpv error code. result is the
+    // command result, if any.
+    void commandFinished(qint64 id, int error, const QVariant &result);
+    void frameGrabbed(qint64 id, int error, const QImage &image);
+    // grabTime and encodeTime are in milliseconds.
+    void screenshotSaved(qint64 id, int error, const QString &filePath,
+                         int grabTime, int encodeTime);
 
     void sourceChanged();
     void videoSizeChanged();
@@ -616,6 +1072,7 @@ Q_SIGNALS:
     void screenshotDirectoryChanged();
     void profileChanged();
     void hrSeekChanged();
+    void videoSyncChanged();
     void ytdlChanged();
     void loadScriptsChanged();
     void pathChanged();
@@ -634,6 +1091,20 @@ Q_SIGNALS:
     void avsyncChanged();
     void percentPosChanged();
     void estimatedVfFpsChanged();
+    void eventBatchSizeChanged();
+    void eventBatchTimeBudgetChanged();
+    void notificationRatesChanged();
+    void scrubbingChanged();
+    void seekLatencyChanged();
+    void asynchronousInitializationChanged();
+    void handlePoolSizeChanged();
+    void directRenderingChanged();
+    void framebufferSizeChanged();
+    void renderBackendChanged();
+    void frameReadbackEnabledChanged();
+    void readbackStatisticsChanged();
+    void screenshotConcurrencyChanged();
+    void screenshotQueueDepthChanged();
 };
 
 Q_DECLARE_METATYPE(MpvDeclarativeObject::MediaTracks)
@@ -33,13 +33,20 @@
  * for other languages.
  */
 
+#include <cstddef>
 #include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
 
 #include <QHash>
 #include <QList>
 #include <QMetaType>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QSharedPointer>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
 
 namespace mpv::qt {
@@ -106,44 +113,181 @@ static inline QVariant node_to_variant(const mpv_node *node) {
     }
 }
 
+/**
+ * Return the value carried by a mpv_event_property (as delivered with
+ * MPV_EVENT_PROPERTY_CHANGE or MPV_EVENT_GET_PROPERTY_REPLY) converted to
+ * QVariant, or QVariant() if the property is unavailable or was observed with
+ * MPV_FORMAT_NONE.
+ */
+static inline QVariant property_to_variant(const mpv_event_property *prop) {
+    if (prop == nullptr || prop->data == nullptr) {
+        return QVariant();
+    }
+    switch (prop->format) {
+    case MPV_FORMAT_STRING:
+    case MPV_FORMAT_OSD_STRING:
+        return QVariant(
+            QString::fromUtf8(*static_cast<const char *const *>(prop->data)));
+    case MPV_FORMAT_FLAG:
+        return QVariant(*static_cast<const int *>(prop->data) != 0);
+    case MPV_FORMAT_INT64:
+        return QVariant(
+            static_cast<qlonglong>(*static_cast<const int64_t *>(prop->data)));
+    case MPV_FORMAT_DOUBLE:
+        return QVariant(*static_cast<const double *>(prop->data));
+    case MPV_FORMAT_NODE:
+        return node_to_variant(static_cast<const mpv_node *>(prop->data));
+    default: // MPV_FORMAT_NONE, unknown values (e.g. future extensions)
+        return QVariant();
+    }
+}
+
+/**
+ * Bump allocator backing the mpv_node trees built by node_builder. Memory is
+ * handed out linearly from one block and released all at once by reset(), so
+ * a long-lived arena (e.g. one per player) stops allocating once its block is
+ * large enough for the biggest command it had to build.
+ *
+ * Not thread safe, and only one node_builder may use an arena at a time.
+ */
+class node_arena {
+public:
+    explicit node_arena(std::size_t block_size = 4096)
+        : block_size_(block_size) {}
+
+    void *allocate(std::size_t size,
+                   std::size_t align = alignof(std::max_align_t)) {
+        std::size_t offset = (used_ + align - 1) & ~(align - 1);
+        if (blocks_.empty() || offset + size > blocks_.back().size) {
+            const std::size_t block_size = qMax(block_size_, size + align);
+            blocks_.push_back({std::make_unique<char[]>(block_size),
+                               block_size});
+            used_ = 0;
+            offset = 0;
+        }
+        used_ = offset + size;
+        return blocks_.back().data.get() + offset;
+    }
+
+    // Zero-initialized array of num T, T must be trivially destructible.
+    template <typename T>
+    T *allocate_array(int num) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "node_arena never runs destructors");
+        const std::size_t size = sizeof(T) * qMax(num, 1);
+        void *data = allocate(size, alignof(T));
+        std::memset(data, 0, size);
+        return static_cast<T *>(data);
+    }
+
+    // Release everything allocated so far. If the last round needed more than
+    // one block, they are merged into a single one so that the next round of
+    // the same size fits without allocating.
+    void reset() {
+        if (blocks_.size() > 1) {
+            std::size_t total = 0;
+            for (const block &b : blocks_) {
+                total += b.size;
+            }
+            blocks_.clear();
+            block_size_ = qMax(block_size_, total);
+            blocks_.push_back({std::make_unique<char[]>(block_size_),
+                               block_size_});
+        }
+        used_ = 0;
+    }
+
+private:
+    Q_DISABLE_COPY(node_arena)
+    struct block {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+    std::vector<block> blocks_;
+    std::size_t block_size_;
+    std::size_t used_ = 0;
+};
+
+/**
+ * Builds a mpv_node tree from a QVariant or a list of strings. All memory
+ * comes from a node_arena, either the one passed in (which is reset when the
+ * builder goes away) or a private one.
+ */
 struct node_builder {
-    node_builder(const QVariant &v) { set(&node_, v); }
-    ~node_builder() { free_node(&node_); }
+    explicit node_builder(const QVariant &v, node_arena *arena = nullptr)
+        : arena_(arena != nullptr ? arena : &local_arena_) {
+        set(&node_, v);
+    }
+    // Plain string argument list, e.g. a command, without going through
+    // QVariantList.
+    explicit node_builder(const QStringList &args,
+                          node_arena *arena = nullptr)
+        : arena_(arena != nullptr ? arena : &local_arena_) {
+        mpv_node_list *list = create_list(&node_, false, args.size());
+        list->num = args.size();
+        for (int n = 0; n < args.size(); n++) {
+            set_string(&list->values[n], args.at(n));
+        }
+    }
+    ~node_builder() { arena_->reset(); }
     mpv_node *node() { return &node_; }
 
 private:
     Q_DISABLE_COPY(node_builder)
+    node_arena local_arena_{512};
+    node_arena *arena_;
     mpv_node node_;
     mpv_node_list *create_list(mpv_node *dst, bool is_map, int num) {
         dst->format = is_map ? MPV_FORMAT_NODE_MAP : MPV_FORMAT_NODE_ARRAY;
-        auto *list = new mpv_node_list();
-        dst->u.list = list;
-        if (list == nullptr) {
-            goto err;
-        }
-        list->values = new mpv_node[num]();
-        if (list->values == nullptr) {
-            goto err;
-        }
+        auto *list = arena_->allocate_array<mpv_node_list>(1);
+        list->values = arena_->allocate_array<mpv_node>(num);
         if (is_map) {
-            list->keys = new char *[num]();
-            if (list->keys == nullptr) {
-                goto err;
-            }
+            list->keys = arena_->allocate_array<char *>(num);
         }
+        dst->u.list = list;
         return list;
-    err:
-        free_node(dst);
-        return nullptr;
     }
+    // Encode s as UTF-8 straight into the arena, without the temporary
+    // QByteArray of QString::toUtf8().
     char *dup_qstring(const QString &s) {
-        QByteArray b = s.toUtf8();
-        char *r = new char[b.size() + 1];
-        if (r != nullptr) {
-            std::memcpy(r, b.data(), b.size() + 1);
+        // Every UTF-16 code unit takes at most 3 bytes in UTF-8 (a surrogate
+        // pair takes 4 for 2 units).
+        auto *r = static_cast<char *>(arena_->allocate(s.size() * 3 + 1, 1));
+        auto *out = reinterpret_cast<unsigned char *>(r);
+        const QChar *in = s.constData();
+        const QChar *end = in + s.size();
+        while (in != end) {
+            uint c = (in++)->unicode();
+            if (QChar::isHighSurrogate(c) && in != end &&
+                in->isLowSurrogate()) {
+                c = QChar::surrogateToUcs4(static_cast<ushort>(c),
+                                           (in++)->unicode());
+            } else if (QChar::isSurrogate(c)) {
+                c = QChar::ReplacementCharacter;
+            }
+            if (c < 0x80) {
+                *out++ = static_cast<unsigned char>(c);
+            } else if (c < 0x800) {
+                *out++ = static_cast<unsigned char>(0xc0 | (c >> 6));
+                *out++ = static_cast<unsigned char>(0x80 | (c & 0x3f));
+            } else if (c < 0x10000) {
+                *out++ = static_cast<unsigned char>(0xe0 | (c >> 12));
+                *out++ = static_cast<unsigned char>(0x80 | ((c >> 6) & 0x3f));
+                *out++ = static_cast<unsigned char>(0x80 | (c & 0x3f));
+            } else {
+                *out++ = static_cast<unsigned char>(0xf0 | (c >> 18));
+                *out++ = static_cast<unsigned char>(0x80 | ((c >> 12) & 0x3f));
+                *out++ = static_cast<unsigned char>(0x80 | ((c >> 6) & 0x3f));
+                *out++ = static_cast<unsigned char>(0x80 | (c & 0x3f));
+            }
         }
+        *out = '\0';
         return r;
     }
+    void set_string(mpv_node *dst, const QString &s) {
+        dst->format = MPV_FORMAT_STRING;
+        dst->u.string = dup_qstring(s);
+    }
     bool test_type(const QVariant &v, QMetaType::Type t) {
         // The Qt docs say: "Although this function is declared as returning
         // "QVariant::Type(obsolete), the return value should be interpreted
@@ -153,10 +297,13 @@ private:
     }
     void set(mpv_node *dst, const QVariant &src) {
         if (test_type(src, QMetaType::QString)) {
-            dst->format = MPV_FORMAT_STRING;
-            dst->u.string = dup_qstring(src.toString());
-            if (dst->u.string == nullptr) {
-                goto fail;
+            set_string(dst, src.toString());
+        } else if (test_type(src, QMetaType::QStringList)) {
+            const QStringList qlist = src.toStringList();
+            mpv_node_list *list = create_list(dst, false, qlist.size());
+            list->num = qlist.size();
+            for (int n = 0; n < qlist.size(); n++) {
+                set_string(&list->values[n], qlist.at(n));
             }
         } else if (test_type(src, QMetaType::Bool)) {
             dst->format = MPV_FORMAT_FLAG;
@@ -171,63 +318,24 @@ private:
             dst->format = MPV_FORMAT_DOUBLE;
             dst->u.double_ = src.toDouble();
         } else if (src.canConvert<QVariantList>()) {
-            QVariantList qlist = src.toList();
+            const QVariantList qlist = src.toList();
             mpv_node_list *list = create_list(dst, false, qlist.size());
-            if (list == nullptr) {
-                goto fail;
-            }
             list->num = qlist.size();
             for (int n = 0; n < qlist.size(); n++) {
-                set(&list->values[n], qlist[n]);
+                set(&list->values[n], qlist.at(n));
             }
         } else if (src.canConvert<QVariantMap>()) {
-            QVariantMap qmap = src.toMap();
+            const QVariantMap qmap = src.toMap();
             mpv_node_list *list = create_list(dst, true, qmap.size());
-            if (list == nullptr) {
-                goto fail;
-            }
             list->num = qmap.size();
-            for (int n = 0; n < qmap.size(); n++) {
-                list->keys[n] = dup_qstring(qmap.keys()[n]);
-                if (list->keys[n] == nullptr) {
-                    free_node(dst);
-                    goto fail;
-                }
-                set(&list->values[n], qmap.values()[n]);
+            int n = 0;
+            for (auto it = qmap.cbegin(); it != qmap.cend(); ++it, ++n) {
+                list->keys[n] = dup_qstring(it.key());
+                set(&list->values[n], it.value());
             }
         } else {
-            goto fail;
+            dst->format = MPV_FORMAT_NONE;
         }
-        return;
-    fail:
-        dst->format = MPV_FORMAT_NONE;
-    }
-    void free_node(mpv_node *dst) {
-        switch (dst->format) {
-        case MPV_FORMAT_STRING:
-            delete[] dst->u.string;
-            break;
-        case MPV_FORMAT_NODE_ARRAY:
-        case MPV_FORMAT_NODE_MAP: {
-            mpv_node_list *list = dst->u.list;
-            if (list != nullptr) {
-                for (int n = 0; n < list->num; n++) {
-                    if (list->keys != nullptr) {
-                        delete[] list->keys[n];
-                    }
-                    if (list->values != nullptr) {
-                        free_node(&list->values[n]);
-                    }
-                }
-                delete[] list->keys;
-                delete[] list->values;
-            }
-            delete list;
-            break;
-        }
-        default:;
-        }
-        dst->format = MPV_FORMAT_NONE;
     }
 };
 
@@ -299,12 +407,26 @@ static inline QVariant get_property(mpv_handle *ctx, const QString &name) {
  * @return mpv error code (<0 on error, >= 0 on success)
  */
 static inline int set_property(mpv_handle *ctx, const QString &name,
-                               const QVariant &v) {
-    node_builder node(v);
+                               const QVariant &v,
+                               node_arena *arena = nullptr) {
+    node_builder node(v, arena);
     return mpv_set_property(ctx, name.toUtf8().constData(), MPV_FORMAT_NODE,
                             node.node());
 }
 
+/**
+ * Set the given option as mpv_node converted from the QVariant argument. Meant
+ * for options that must be set before mpv_initialize().
+ *
+ * @return mpv error code (<0 on error, >= 0 on success)
+ */
+static inline int set_option(mpv_handle *ctx, const QString &name,
+                             const QVariant &v, node_arena *arena = nullptr) {
+    node_builder node(v, arena);
+    return mpv_set_option(ctx, name.toUtf8().constData(), MPV_FORMAT_NODE,
+                          node.node());
+}
+
 /**
  * Set the given property asynchronously as mpv_node converted from the QVariant
  * argument.
@@ -313,8 +435,9 @@ static inline int set_property(mpv_handle *ctx, const QString &name,
  */
 static inline int set_property_async(mpv_handle *ctx, const QString &name,
                                      const QVariant &v,
-                                     quint64 reply_userdata) {
-    node_builder node(v);
+                                     quint64 reply_userdata,
+                                     node_arena *arena = nullptr) {
+    node_builder node(v, arena);
     return mpv_set_property_async(ctx, reply_userdata,
                                   name.toUtf8().constData(), MPV_FORMAT_NODE,
                                   node.node());
@@ -326,8 +449,10 @@ static inline int set_property_async(mpv_handle *ctx, const QString &name,
  * @param args command arguments, with args[0] being the command name as string
  * @return the property value, or an ErrorReturn with the error code
  */
-static inline QVariant command(mpv_handle *ctx, const QVariant &args) {
-    node_builder node(args);
+template <typename Args>
+static inline QVariant command(mpv_handle *ctx, const Args &args,
+                               node_arena *arena = nullptr) {
+    node_builder node(args, arena);
     mpv_node res;
     int err = mpv_command_node(ctx, node.node(), &res);
     if (err < 0) {
@@ -343,12 +468,245 @@ static inline QVariant command(mpv_handle *ctx, const QVariant &args) {
  * @param args command arguments, with args[0] being the command name as string
  * @return mpv error code (<0 on error, >= 0 on success)
  */
-static inline int command_async(mpv_handle *ctx, const QVariant &args,
-                                quint64 reply_userdata) {
-    node_builder node(args);
+template <typename Args>
+static inline int command_async(mpv_handle *ctx, const Args &args,
+                                quint64 reply_userdata,
+                                node_arena *arena = nullptr) {
+    node_builder node(args, arena);
     return mpv_command_node_async(ctx, reply_userdata, node.node());
 }
 
+/**
+ * Holds a value in the native mpv format matching T, for passing it to the
+ * mpv_set_property() family without building a mpv_node.
+ */
+template <typename T>
+struct native_value;
+
+template <>
+struct native_value<double> {
+    static constexpr mpv_format format = MPV_FORMAT_DOUBLE;
+    explicit native_value(double v) : value(v) {}
+    void *data() { return &value; }
+    double value;
+};
+
+template <>
+struct native_value<qint64> {
+    static constexpr mpv_format format = MPV_FORMAT_INT64;
+    explicit native_value(qint64 v) : value(v) {}
+    void *data() { return &value; }
+    int64_t value;
+};
+
+template <>
+struct native_value<bool> {
+    static constexpr mpv_format format = MPV_FORMAT_FLAG;
+    explicit native_value(bool v) : value(v ? 1 : 0) {}
+    void *data() { return &value; }
+    int value;
+};
+
+template <>
+struct native_value<QString> {
+    static constexpr mpv_format format = MPV_FORMAT_STRING;
+    explicit native_value(const QString &v)
+        : utf8(v.toUtf8()), value(utf8.constData()) {}
+    void *data() { return &value; }
+    QByteArray utf8;
+    const char *value;
+};
+
+/**
+ * Read the given property in the native mpv format matching T (double,
+ * qint64, bool or QString), without going through mpv_node and QVariant.
+ * result is left untouched on error.
+ *
+ * @return mpv error code (<0 on error, >= 0 on success)
+ */
+template <typename T>
+int get(mpv_handle *ctx, const char *name, T *result);
+
+template <>
+inline int get<double>(mpv_handle *ctx, const char *name, double *result) {
+    return mpv_get_property(ctx, name, MPV_FORMAT_DOUBLE, result);
+}
+
+template <>
+inline int get<qint64>(mpv_handle *ctx, const char *name, qint64 *result) {
+    int64_t value = 0;
+    const int err = mpv_get_property(ctx, name, MPV_FORMAT_INT64, &value);
+    if (err >= 0) {
+        *result = value;
+    }
+    return err;
+}
+
+template <>
+inline int get<bool>(mpv_handle *ctx, const char *name, bool *result) {
+    int value = 0;
+    const int err = mpv_get_property(ctx, name, MPV_FORMAT_FLAG, &value);
+    if (err >= 0) {
+        *result = (value != 0);
+    }
+    return err;
+}
+
+template <>
+inline int get<QString>(mpv_handle *ctx, const char *name, QString *result) {
+    char *value = nullptr;
+    const int err = mpv_get_property(ctx, name, MPV_FORMAT_STRING, &value);
+    if (err >= 0) {
+        *result = QString::fromUtf8(value);
+        mpv_free(value);
+    }
+    return err;
+}
+
+/**
+ * Set the given property in the native mpv format matching T (double,
+ * qint64, bool or QString).
+ *
+ * @return mpv error code (<0 on error, >= 0 on success)
+ */
+template <typename T>
+static inline int set(mpv_handle *ctx, const char *name, const T &value) {
+    native_value<T> v(value);
+    return mpv_set_property(ctx, name, native_value<T>::format, v.data());
+}
+
+/**
+ * Set the given property asynchronously in the native mpv format matching T.
+ * mpv copies the value before returning.
+ *
+ * @return mpv error code (<0 on error, >= 0 on success)
+ */
+template <typename T>
+static inline int set_async(mpv_handle *ctx, const char *name, const T &value,
+                            quint64 reply_userdata) {
+    native_value<T> v(value);
+    return mpv_set_property_async(ctx, reply_userdata, name,
+                                  native_value<T>::format, v.data());
+}
+
+/**
+ * Process-wide pool of initialized mpv handles, so that a new player doesn't
+ * have to wait for mpv_create() and mpv_initialize(). Handles are given back
+ * after playback was stopped and the options changed on them were restored,
+ * and are destroyed instead once the pool is full.
+ *
+ * The pool is empty (capacity 0) until set_capacity() is called. Thread safe.
+ */
+class handle_pool {
+public:
+    static handle_pool &instance() {
+        static handle_pool pool;
+        return pool;
+    }
+
+    int capacity() const {
+        QMutexLocker locker(&mutex_);
+        return capacity_;
+    }
+
+    // Surplus handles are destroyed right away, call fill() to create the
+    // missing ones.
+    void set_capacity(int capacity) {
+        QList<Handle> surplus;
+        QMutexLocker locker(&mutex_);
+        capacity_ = qMax(capacity, 0);
+        while (handles_.size() > capacity_) {
+            surplus.append(handles_.takeLast());
+        }
+        locker.unlock();
+        // mpv_terminate_destroy() runs here, without holding the lock.
+        surplus.clear();
+    }
+
+    int size() const {
+        QMutexLocker locker(&mutex_);
+        return handles_.size();
+    }
+
+    // Create and initialize handles until the pool is full. This blocks for
+    // as long as mpv_initialize() takes, so better run it on a worker thread.
+    void fill() {
+        for (;;) {
+            QMutexLocker locker(&mutex_);
+            if (handles_.size() >= capacity_) {
+                return;
+            }
+            locker.unlock();
+            mpv_handle *raw = mpv_create();
+            if (raw == nullptr) {
+                return;
+            }
+            Handle handle = Handle::FromRawHandle(raw);
+            if (mpv_initialize(handle) < 0) {
+                return;
+            }
+            locker.relock();
+            if (handles_.size() >= capacity_) {
+                return;
+            }
+            handles_.append(handle);
+        }
+    }
+
+    // Take an initialized handle out of the pool, or a null Handle if it is
+    // empty.
+    Handle acquire() {
+        QMutexLocker locker(&mutex_);
+        return handles_.isEmpty() ? Handle() : handles_.takeFirst();
+    }
+
+    // Stop playback, restore the given options to their defaults and keep the
+    // handle for reuse if there's room. The caller must have unobserved its
+    // properties and must not hold other references to the handle. This
+    // waits for mpv to stop, so better run it on a worker thread as well.
+    // Returns whether the handle was kept.
+    bool release(const Handle &handle, const QStringList &options) {
+        if ((handle == nullptr) || (capacity() <= 0)) {
+            return false;
+        }
+        mpv_set_wakeup_callback(handle, nullptr, nullptr);
+        const char *stop[] = {"stop", nullptr};
+        if (mpv_command(handle, stop) < 0) {
+            return false;
+        }
+        for (const QString &name : options) {
+            const QByteArray info =
+                QByteArrayLiteral("option-info/") + name.toUtf8() +
+                QByteArrayLiteral("/default-value");
+            mpv_node value;
+            // Not an option, e.g. a runtime only property.
+            if (mpv_get_property(handle, info.constData(), MPV_FORMAT_NODE,
+                                 &value) < 0) {
+                continue;
+            }
+            mpv_set_property(handle, name.toUtf8().constData(),
+                             MPV_FORMAT_NODE, &value);
+            mpv_free_node_contents(&value);
+        }
+        // Whatever is still queued was meant for the previous owner.
+        while (mpv_wait_event(handle, 0)->event_id != MPV_EVENT_NONE) {
+        }
+        QMutexLocker locker(&mutex_);
+        if (handles_.size() >= capacity_) {
+            return false;
+        }
+        handles_.append(handle);
+        return true;
+    }
+
+private:
+    handle_pool() = default;
+
+    mutable QMutex mutex_;
+    int capacity_ = 0;
+    QList<Handle> handles_;
+};
+
 } // namespace mpv::qt
 
 Q_DECLARE_METATYPE(mpv::qt::ErrorReturn)